@@ -7,6 +7,8 @@
 #define slic3r_AABBTreeIndirect_hpp_
 
 #include <algorithm>
+#include <array>
+#include <cstdint>
 #include <limits>
 #include <type_traits>
 #include <vector>
@@ -470,6 +472,94 @@ namespace detail {
 		}
 	}
 
+	// Packet of up to PacketSize rays traversing the AABB tree together, see intersect_ray_packet_first_hit().
+	// The rays are stored as structure of arrays, so that the ray / box tests of the whole packet are vectorized by the compiler.
+	template<typename AVertexType, typename AIndexedFaceType, typename ATreeType, typename AScalar, size_t PacketSize>
+	struct RayPacketIntersector {
+		using VertexType 		= AVertexType;
+		using IndexedFaceType 	= AIndexedFaceType;
+		using TreeType			= ATreeType;
+		using Scalar 			= AScalar;
+		using Vector 			= Eigen::Matrix<Scalar, 3, 1, Eigen::DontAlign>;
+		using Lanes 			= std::array<Scalar, PacketSize>;
+		static_assert(PacketSize > 0 && PacketSize <= 32, "Packet mask is stored in 32 bits");
+
+		const std::vector<VertexType> 		&vertices;
+		const std::vector<IndexedFaceType> 	&faces;
+		const TreeType 						&tree;
+		const double  						 eps;
+
+		std::array<Lanes, 3>				 origin;
+		std::array<Lanes, 3>				 dir;
+		std::array<Lanes, 3>				 invdir;
+		// Parameter of the closest hit found so far. Lanes not carrying any ray are set to -infinity, thus they never hit a box.
+		Lanes 								 min_t;
+		std::array<igl::Hit, PacketSize> 	&hits;
+
+		// Bit mask of the rays intersecting the box before their closest hit found so far.
+		template<typename BBox>
+		uint32_t intersect_box(const BBox &bbox, uint32_t mask) const {
+			Lanes tnear, tfar;
+			for (size_t i = 0; i < PacketSize; ++ i) {
+				tnear[i] = Scalar(0);
+				tfar[i]  = min_t[i];
+			}
+			for (int axis = 0; axis < 3; ++ axis) {
+				const Scalar lo = Scalar(bbox.min()(axis));
+				const Scalar hi = Scalar(bbox.max()(axis));
+				for (size_t i = 0; i < PacketSize; ++ i) {
+					Scalar t1 = (lo - origin[axis][i]) * invdir[axis][i];
+					Scalar t2 = (hi - origin[axis][i]) * invdir[axis][i];
+					tnear[i] = std::max(tnear[i], std::min(t1, t2));
+					tfar[i]  = std::min(tfar[i],  std::max(t1, t2));
+				}
+			}
+			uint32_t out = 0;
+			for (size_t i = 0; i < PacketSize; ++ i)
+				out |= uint32_t(tnear[i] <= tfar[i]) << i;
+			return out & mask;
+		}
+
+		Vector ray_origin(size_t i) const { return { origin[0][i], origin[1][i], origin[2][i] }; }
+		Vector ray_dir(size_t i)    const { return { dir[0][i], dir[1][i], dir[2][i] }; }
+	};
+
+    template<typename RayPacketIntersectorType>
+	static inline void intersect_ray_packet_recursive_first_hit(RayPacketIntersectorType &packet, size_t node_idx, uint32_t mask)
+	{
+		const auto &node = packet.tree.node(node_idx);
+		assert(node.is_valid());
+
+		mask = packet.intersect_box(node.bbox, mask);
+		if (mask == 0)
+			return;
+
+	  	if (node.is_leaf()) {
+            auto face = packet.faces[node.idx];
+            const auto &v0 = packet.vertices[face(0)];
+            const auto &v1 = packet.vertices[face(1)];
+            const auto &v2 = packet.vertices[face(2)];
+			for (; mask != 0; mask &= mask - 1) {
+				// Index of the lowest set bit.
+				size_t i = 0;
+				while (((mask >> i) & 1) == 0)
+					++ i;
+			    double t, u, v;
+			    if (intersect_triangle(packet.ray_origin(i), packet.ray_dir(i), v0, v1, v2, t, u, v, packet.eps) &&
+			    	t > 0. && t < packet.min_t[i]) {
+			    	packet.min_t[i] = typename RayPacketIntersectorType::Scalar(t);
+	                packet.hits[i]  = igl::Hit { int(node.idx), -1, float(u), float(v), float(t) };
+			    }
+			}
+	  	} else {
+			// Left / right child node index.
+			size_t left  = node_idx * 2 + 1;
+			size_t right = left + 1;
+			intersect_ray_packet_recursive_first_hit(packet, left,  mask);
+			intersect_ray_packet_recursive_first_hit(packet, right, mask);
+		}
+	}
+
     // Real-time collision detection, Ericson, Chapter 5
     template<typename Vector>
     static inline Vector closest_point_to_triangle(const Vector &p, const Vector &a, const Vector &b, const Vector &c)
@@ -746,6 +836,56 @@ inline bool intersect_ray_first_hit(
         ray_intersector, size_t(0), std::numeric_limits<Scalar>::infinity(), hit);
 }
 
+// Find first intersections of a packet of up to PacketSize rays with indexed triangle set.
+// The packet traverses the tree once, a node is visited if any of the rays intersects its bounding box
+// before its closest hit found so far. Rays sharing an origin or pointing to a similar direction, as for example
+// the rays sampling a hemisphere, share most of the visited nodes and the ray / box tests of the packet are vectorized.
+// The result is equal to calling intersect_ray_first_hit() for each ray.
+// Returns a bit mask of the rays, which intersect the triangle set. The hits are only valid for these rays.
+template<size_t PacketSize, typename VertexType, typename IndexedFaceType, typename TreeType, typename VectorType>
+inline uint32_t intersect_ray_packet_first_hit(
+	// Indexed triangle set - 3D vertices.
+	const std::vector<VertexType> 		&vertices,
+	// Indexed triangle set - triangular faces, references to vertices.
+	const std::vector<IndexedFaceType> 	&faces,
+	// AABBTreeIndirect::Tree over vertices & faces, bounding boxes built with the accuracy of vertices.
+	const TreeType 						&tree,
+	// Origins of the rays.
+	const VectorType					*origins,
+	// Directions of the rays.
+	const VectorType 					*dirs,
+	// Number of rays, at most PacketSize.
+	size_t 								 num_rays,
+	// First intersections of the rays with the indexed triangle set.
+	std::array<igl::Hit, PacketSize>	&hits,
+	// Epsilon for the ray-triangle intersection, it should be proportional to an average triangle edge length.
+	const double 						 eps = 0.000001)
+{
+    using Scalar = typename VectorType::Scalar;
+	assert(num_rays <= PacketSize);
+	if (tree.empty() || num_rays == 0)
+		return 0;
+	detail::RayPacketIntersector<VertexType, IndexedFaceType, TreeType, Scalar, PacketSize> packet { vertices, faces, tree, eps, {}, {}, {}, {}, hits };
+	for (size_t i = 0; i < PacketSize; ++ i) {
+		// Unused lanes repeat the first ray, they are excluded by their min_t.
+		const VectorType &origin = origins[i < num_rays ? i : 0];
+		const VectorType &dir    = dirs[i < num_rays ? i : 0];
+		for (int axis = 0; axis < 3; ++ axis) {
+			packet.origin[axis][i] = origin(axis);
+			packet.dir[axis][i]    = dir(axis);
+			packet.invdir[axis][i] = Scalar(1) / dir(axis);
+		}
+		packet.min_t[i] = i < num_rays ? std::numeric_limits<Scalar>::infinity() : - std::numeric_limits<Scalar>::infinity();
+	}
+	const uint32_t all = num_rays == 32 ? uint32_t(-1) : (uint32_t(1) << num_rays) - 1;
+	detail::intersect_ray_packet_recursive_first_hit(packet, size_t(0), all);
+	uint32_t mask = 0;
+	for (size_t i = 0; i < num_rays; ++ i)
+		if (packet.min_t[i] < std::numeric_limits<Scalar>::infinity())
+			mask |= uint32_t(1) << i;
+	return mask;
+}
+
 // Find all intersections of a ray with indexed triangle set.
 // Intersection test is calculated with the accuracy of VectorType::Scalar
 // even if the triangle mesh and the AABB Tree are built with floats.
@@ -2,6 +2,11 @@
 // CuraEngine is released under the terms of the AGPLv3 or higher.
 
 #include <algorithm> //For std::partition_copy and std::min_element.
+#include <array>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
 #include <unordered_set>
 
 #include "WallToolPaths.hpp"
@@ -16,6 +21,7 @@
 #include "SVG.hpp"
 #include "Utils.hpp"
 
+#include <boost/functional/hash.hpp>
 #include <boost/log/trivial.hpp>
 
 //#define ARACHNE_STITCH_PATCH_DEBUG
@@ -52,6 +58,95 @@ WallToolPathsParams make_paths_params(const int layer_id, const PrintObjectConfi
     return input_params;
 }
 
+// Cache of the generated toolpaths shared by all WallToolPaths instances.
+// Vertical walls of prismatic parts produce identical outlines over hundreds of layers, which then share
+// the Voronoi diagram, the skeletal trapezoidation and the post-processing of the toolpaths.
+// The toolpaths are a function of the outline and of the parameters of the generator only, therefore
+// the cache is never invalidated, the oldest entries are evicted once the cache grows too large.
+class ToolPathsCache
+{
+public:
+    struct Key
+    {
+        Polygons                outline;
+        std::array<double, 13>  params;
+        size_t                  hash { 0 };
+
+        bool operator==(const Key &rhs) const { return hash == rhs.hash && params == rhs.params && outline == rhs.outline; }
+    };
+
+    struct KeyHash
+    {
+        size_t operator()(const Key &key) const { return key.hash; }
+    };
+
+    struct Value
+    {
+        std::vector<VariableWidthLines> toolpaths;
+        Polygons                        inner_contour;
+    };
+
+    static ToolPathsCache& instance()
+    {
+        static ToolPathsCache cache;
+        return cache;
+    }
+
+    std::shared_ptr<const Value> find(const Key &key) const
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        auto it = m_map.find(key);
+        return it == m_map.end() ? nullptr : it->second;
+    }
+
+    void insert(Key &&key, std::shared_ptr<const Value> value)
+    {
+        size_t num_junctions = 0;
+        for (const VariableWidthLines &lines : value->toolpaths)
+            for (const ExtrusionLine &line : lines)
+                num_junctions += line.size();
+        if (num_junctions > MAX_JUNCTIONS / 4)
+            // Don't let a single huge island flush the cache.
+            return;
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (auto [it, inserted] = m_map.emplace(std::move(key), std::move(value)); inserted) {
+            m_fifo.emplace_back(&it->first, num_junctions);
+            m_num_junctions += num_junctions;
+            while (m_num_junctions > MAX_JUNCTIONS || m_fifo.size() > MAX_ENTRIES) {
+                m_num_junctions -= m_fifo.front().second;
+                m_map.erase(*m_fifo.front().first);
+                m_fifo.pop_front();
+            }
+        }
+    }
+
+private:
+    static constexpr const size_t MAX_ENTRIES   = 4096;
+    static constexpr const size_t MAX_JUNCTIONS = 4 * 1024 * 1024;
+
+    mutable std::mutex                                                      m_mutex;
+    std::unordered_map<Key, std::shared_ptr<const Value>, KeyHash>          m_map;
+    // Keys in the order of insertion with the number of junctions of their toolpaths.
+    std::deque<std::pair<const Key*, size_t>>                               m_fifo;
+    size_t                                                                  m_num_junctions { 0 };
+};
+
+static ToolPathsCache::Key make_cache_key(const Polygons &outline, const std::array<double, 13> &params)
+{
+    ToolPathsCache::Key key { outline, params };
+    for (double param : params)
+        boost::hash_combine(key.hash, param);
+    for (const Polygon &polygon : outline) {
+        boost::hash_combine(key.hash, polygon.size());
+        for (const Point &pt : polygon.points) {
+            boost::hash_combine(key.hash, pt.x());
+            boost::hash_combine(key.hash, pt.y());
+        }
+    }
+    return key;
+}
+
 WallToolPaths::WallToolPaths(const Polygons& outline, const coord_t bead_width_0, const coord_t bead_width_x,
                              const size_t inset_count, const coord_t wall_0_inset, const coordf_t layer_height, const WallToolPathsParams &params)
     : outline(outline)
@@ -466,6 +561,17 @@ const std::vector<VariableWidthLines> &WallToolPaths::generate()
     if (this->inset_count < 1)
         return toolpaths;
 
+    ToolPathsCache::Key cache_key = make_cache_key(this->outline, {
+        double(bead_width_0), double(bead_width_x), double(inset_count), double(wall_0_inset), layer_height, double(print_thin_walls),
+        double(min_feature_size), double(min_bead_width), small_area_length, double(wall_transition_filter_deviation),
+        m_params.wall_transition_length, m_params.wall_transition_angle, double(m_params.wall_distribution_count) });
+    if (std::shared_ptr<const ToolPathsCache::Value> cached = ToolPathsCache::instance().find(cache_key); cached) {
+        toolpaths           = cached->toolpaths;
+        inner_contour       = cached->inner_contour;
+        toolpaths_generated = true;
+        return toolpaths;
+    }
+
     const coord_t smallest_segment = Slic3r::Arachne::meshfix_maximum_resolution;
     const coord_t allowed_distance = Slic3r::Arachne::meshfix_maximum_deviation;
     const coord_t epsilon_offset = (allowed_distance / 2) - 1;
@@ -549,6 +655,7 @@ const std::vector<VariableWidthLines> &WallToolPaths::generate()
                               return l.front().inset_idx < r.front().inset_idx;
                           }) && "WallToolPaths should be sorted from the outer 0th to inner_walls");
     toolpaths_generated = true;
+    ToolPathsCache::instance().insert(std::move(cache_key), std::make_shared<const ToolPathsCache::Value>(ToolPathsCache::Value{ toolpaths, inner_contour }));
     return toolpaths;
 }
 
@@ -16,10 +16,6 @@
 #include <algorithm>
 #include <numeric>
 
-// Boost pool: Don't use mutexes to synchronize memory allocation.
-#define BOOST_POOL_NO_MT
-#include <boost/pool/object_pool.hpp>
-
 #include <boost/geometry.hpp>
 #include <boost/geometry/geometries/point.hpp>
 #include <boost/geometry/geometries/segment.hpp>
@@ -235,14 +231,22 @@ static constexpr std::array<std::array<int, 8>, 3> child_traversal_order {
     std::array<int, 8>{ 1, 5, 0, 4, 3, 7, 2, 6 },
 };
 
+// Index of a Cube in Octree::cubes.
+using CubeIdx = uint32_t;
+static constexpr const CubeIdx NoCube = std::numeric_limits<CubeIdx>::max();
+
 struct Cube
 {
     Vec3d center;
 #ifndef NDEBUG
     Vec3d center_octree;
 #endif // NDEBUG
-    std::array<Cube*, 8> children {}; // initialized to nullptrs
-    Cube(const Vec3d &center) : center(center) {}
+    std::array<CubeIdx, 8> children;
+    // Z coordinates of the centers of the children in world coordinates, filled in by Octree::finalize().
+    // Stored with the parent, so that the children not intersecting a layer are culled in a single pass
+    // over a contiguous array without touching their memory.
+    std::array<float, 8>   children_z;
+    Cube(const Vec3d &center) : center(center) { children.fill(NoCube); children_z.fill(0.f); }
 };
 
 struct CubeProperties
@@ -256,17 +260,21 @@ struct CubeProperties
 
 struct Octree
 {
-    // Octree will allocate its Cubes from the pool. The pool only supports deletion of the complete pool,
-    // perfect for building up our octree.
-    boost::object_pool<Cube>    pool;
-    Cube*                       root_cube { nullptr };
+    // All the cubes of the octree, the root cube first. The cubes are only ever added, never removed.
+    // After the octree is built, the cubes are stored in a depth first order, thus each subtree occupies
+    // a contiguous block of memory.
+    std::vector<Cube>           cubes;
     Vec3d                       origin;
     std::vector<CubeProperties> cubes_properties;
 
     Octree(const Vec3d &origin, const std::vector<CubeProperties> &cubes_properties)
-        : root_cube(pool.construct(origin)), origin(origin), cubes_properties(cubes_properties) {}
+        : origin(origin), cubes_properties(cubes_properties) { cubes.emplace_back(origin); }
 
-    void insert_triangle(const Vec3d &a, const Vec3d &b, const Vec3d &c, Cube *current_cube, const BoundingBoxf3 &current_bbox, int depth);
+    const Cube& root_cube() const { return cubes.front(); }
+
+    void insert_triangle(const Vec3d &a, const Vec3d &b, const Vec3d &c, CubeIdx current_cube, const BoundingBoxf3 &current_bbox, int depth);
+    // Rotate the octree to world coordinates, store the cubes in a depth first order and fill in Cube::children_z.
+    void finalize(const Eigen::Matrix3d &rot);
 };
 
 void OctreeDeleter::operator()(Octree *p) {
@@ -368,6 +376,7 @@ struct FillContext
     };
 
     FillContext(const Octree &octree, double z_position, int direction_idx) :
+        cubes(octree.cubes),
         cubes_properties(octree.cubes_properties),
         z_position(z_position),
         traversal_order(child_traversal_order[direction_idx]),
@@ -381,6 +390,7 @@ struct FillContext
     // Rotate the point, uses the same convention as Point::rotate().
     Vec2d rotate(const Vec2d& v) { return Vec2d(this->cos_a * v.x() - this->sin_a * v.y(), this->sin_a * v.x() + this->cos_a * v.y()); }
 
+    const std::vector<Cube>            &cubes;
     const std::vector<CubeProperties>  &cubes_properties;
     // Top of the current layer.
     const double                        z_position;
@@ -424,7 +434,7 @@ static bool verify_traversal_order(
     for (int i = 0; i < 8; ++i) {
         int j = context.traversal_order[i];
         Vec3d cntr = to_world * (cube->center_octree + (child_centers[j] * (context.cubes_properties[depth].edge_length / 4.)));
-        assert(!cube->children[j] || cube->children[j]->center.isApprox(cntr));
+        assert(cube->children[j] == NoCube || context.cubes[cube->children[j]].center.isApprox(cntr));
         c[i] = cntr;
     }
     std::array<Vec3d, 10> dirs = {
@@ -459,8 +469,8 @@ static void generate_infill_lines_recursive(
     const double z_diff     = context.z_position - cube->center.z();
     const double z_diff_abs = std::abs(z_diff);
 
-    if (z_diff_abs > cubes_properties[depth].height / 2.)
-        return;
+    // The cube is known to intersect the layer, the children were culled by their parent.
+    assert(z_diff_abs <= cubes_properties[depth].height / 2. + EPSILON);
 
     if (z_diff_abs < cubes_properties[depth].line_z_distance) {
         // Discretize a single wall splitting the cube into two.
@@ -490,14 +500,29 @@ static void generate_infill_lines_recursive(
         last_line.b = new_line.b;
     }
 
+    if (depth == 0)
+        return;
+
     // left child index
     address = address * 2 + 1;
     -- depth;
+    // Cull the children not intersecting the layer. The loop is branch free over the contiguous children_z,
+    // absent children are placed infinitely far from any layer.
+    const float z_position  = float(context.z_position);
+    // Slightly enlarged, the exact test is performed by the child.
+    const float half_height = float(cubes_properties[depth].height / 2.) + float(EPSILON);
+    uint32_t    mask        = 0;
+    for (int i = 0; i < 8; ++ i)
+        mask |= uint32_t(std::abs(z_position - cube->children_z[i]) <= half_height) << i;
+    if (mask == 0)
+        return;
     size_t i = 0;
     for (const int child_idx : context.traversal_order) {
-        const Cube *child = cube->children[child_idx];
-        if (child != nullptr)
-            generate_infill_lines_recursive(context, child, address, depth);
+        if ((mask >> child_idx) & 1) {
+            const Cube *child = &context.cubes[cube->children[child_idx]];
+            if (std::abs(context.z_position - child->center.z()) <= cubes_properties[depth].height / 2.)
+                generate_infill_lines_recursive(context, child, address, depth);
+        }
         if (++ i == 4)
             // right child index
             ++ address;
@@ -1337,7 +1362,9 @@ void Filler::_fill_surface_single(
         // Generate the infill lines along the octree cells, merge touching lines of the same direction.
         size_t num_lines = 0;
         for (auto &context : contexts) {
-            generate_infill_lines_recursive(context, adapt_fill_octree->root_cube, 0, int(adapt_fill_octree->cubes_properties.size()) - 1);
+            const Cube &root_cube = adapt_fill_octree->root_cube();
+            if (std::abs(this->z - root_cube.center.z()) <= adapt_fill_octree->cubes_properties.back().height / 2.)
+                generate_infill_lines_recursive(context, &root_cube, 0, int(adapt_fill_octree->cubes_properties.size()) - 1);
             num_lines += context.output_lines.size() + context.temp_lines.size();
         }
 
@@ -1451,15 +1478,38 @@ static inline bool is_overhang_triangle(const Vec3d &a, const Vec3d &b, const Ve
     return n.dot(up) > 0.707 * n.norm();
 }
 
-static void transform_center(Cube *current_cube, const Eigen::Matrix3d &rot)
+void Octree::finalize(const Eigen::Matrix3d &rot)
 {
+    // Depth first order of the cubes, the children in the order of child_centers.
+    std::vector<Cube> ordered;
+    ordered.reserve(this->cubes.size());
+    std::vector<CubeIdx> new_idx(this->cubes.size(), NoCube);
+    std::vector<CubeIdx> stack { 0 };
+    while (! stack.empty()) {
+        CubeIdx idx = stack.back();
+        stack.pop_back();
+        new_idx[idx] = CubeIdx(ordered.size());
+        ordered.emplace_back(this->cubes[idx]);
+        const std::array<CubeIdx, 8> &children = this->cubes[idx].children;
+        for (auto it = children.rbegin(); it != children.rend(); ++ it)
+            if (*it != NoCube)
+                stack.emplace_back(*it);
+    }
+    for (Cube &cube : ordered) {
+        for (CubeIdx &child : cube.children)
+            if (child != NoCube)
+                child = new_idx[child];
 #ifndef NDEBUG
-    current_cube->center_octree = current_cube->center;
+        cube.center_octree = cube.center;
 #endif // NDEBUG
-    current_cube->center = rot * current_cube->center;
-    for (auto *child : current_cube->children)
-        if (child)
-            transform_center(child, rot);
+        // Transform the octree to world coordinates to reduce computation when extracting infill lines.
+        cube.center = rot * cube.center;
+    }
+    for (Cube &cube : ordered)
+        for (int i = 0; i < 8; ++ i)
+            cube.children_z[i] = cube.children[i] == NoCube ? std::numeric_limits<float>::max() : float(ordered[cube.children[i]].center.z());
+    this->cubes = std::move(ordered);
+    this->origin = rot * this->origin;
 }
 
 OctreePtr build_octree(
@@ -1487,8 +1537,8 @@ OctreePtr build_octree(
         auto process_triangle = [octree_ptr, max_depth, diag_half](const Vec3d &a, const Vec3d &b, const Vec3d &c) {
             octree_ptr->insert_triangle(
                 a, b, c,
-                octree_ptr->root_cube,
-                BoundingBoxf3(octree_ptr->root_cube->center - diag_half, octree_ptr->root_cube->center + diag_half),
+                0,
+                BoundingBoxf3(octree_ptr->origin - diag_half, octree_ptr->origin + diag_half),
                 max_depth);
         };
         auto up_vector = support_overhangs_only ? Vec3d(transform_to_octree() * Vec3d(0., 0., 1.)) : Vec3d();
@@ -1501,20 +1551,15 @@ OctreePtr build_octree(
         }
         for (size_t i = 0; i < overhang_triangles.size(); i += 3)
             process_triangle(overhang_triangles[i], overhang_triangles[i + 1], overhang_triangles[i + 2]);
-        {
-            // Transform the octree to world coordinates to reduce computation when extracting infill lines.
-            auto rot = transform_to_world().toRotationMatrix();
-            transform_center(octree->root_cube, rot);
-            octree->origin = rot * octree->origin;
-        }
+        octree->finalize(transform_to_world().toRotationMatrix());
     }
 
     return octree;
 }
 
-void Octree::insert_triangle(const Vec3d &a, const Vec3d &b, const Vec3d &c, Cube *current_cube, const BoundingBoxf3 &current_bbox, int depth)
+void Octree::insert_triangle(const Vec3d &a, const Vec3d &b, const Vec3d &c, CubeIdx current_cube, const BoundingBoxf3 &current_bbox, int depth)
 {
-    assert(current_cube);
+    assert(current_cube < this->cubes.size());
     assert(depth > 0);
 
     --depth;
@@ -1522,6 +1567,8 @@ void Octree::insert_triangle(const Vec3d &a, const Vec3d &b, const Vec3d &c, Cub
     // Squared radius of a sphere around the child cube.
     // const double r2_cube = Slic3r::sqr(0.5 * this->cubes_properties[depth].height + EPSILON);
 
+    // Cubes may be reallocated by inserting a child, don't keep a reference.
+    const Vec3d center = this->cubes[current_cube].center;
     for (size_t i = 0; i < 8; ++ i) {
         const Vec3d &child_center_dir = child_centers[i];
         // Calculate a slightly expanded bounding box of a child cube to cope with triangles touching a cube wall and other numeric errors.
@@ -1530,20 +1577,22 @@ void Octree::insert_triangle(const Vec3d &a, const Vec3d &b, const Vec3d &c, Cub
         for (int k = 0; k < 3; ++ k) {
             if (child_center_dir[k] == -1.) {
                 bbox.min[k] = current_bbox.min[k];
-                bbox.max[k] = current_cube->center[k] + EPSILON;
+                bbox.max[k] = center[k] + EPSILON;
             } else {
-                bbox.min[k] = current_cube->center[k] - EPSILON;
+                bbox.min[k] = center[k] - EPSILON;
                 bbox.max[k] = current_bbox.max[k];
             }
         }
-        Vec3d child_center = current_cube->center + (child_center_dir * (this->cubes_properties[depth].edge_length / 2.));
         //if (dist2_to_triangle(a, b, c, child_center) < r2_cube) {
         // dist2_to_triangle and r2_cube are commented out too.
         if (triangle_AABB_intersects(a, b, c, bbox)) {
-            if (! current_cube->children[i])
-                current_cube->children[i] = this->pool.construct(child_center);
+            if (this->cubes[current_cube].children[i] == NoCube) {
+                Vec3d child_center = center + (child_center_dir * (this->cubes_properties[depth].edge_length / 2.));
+                this->cubes[current_cube].children[i] = CubeIdx(this->cubes.size());
+                this->cubes.emplace_back(child_center);
+            }
             if (depth > 0)
-                this->insert_triangle(a, b, c, current_cube->children[i], bbox, depth);
+                this->insert_triangle(a, b, c, this->cubes[current_cube].children[i], bbox, depth);
         }
     }
 }
@@ -3,7 +3,14 @@
 #include "../Surface.hpp"
 #include <cmath>
 #include <algorithm>
+#include <deque>
+#include <functional>
 #include <iostream>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+
+#include <boost/functional/hash.hpp>
 
 #include "FillGyroid.hpp"
 
@@ -62,6 +69,15 @@ static inline Polyline make_wave(
     return polyline;
 }
 
+// Evaluate the wave at the samples xs into ys. The samples are independent of each other,
+// so the loop is free of dependencies to be vectorized by the compiler if a vector math library is available.
+static inline void f(const std::vector<double> &xs, std::vector<double> &ys, double z_sin, double z_cos, bool vertical, bool flip)
+{
+    ys.resize(xs.size());
+    for (size_t i = 0; i < xs.size(); ++ i)
+        ys[i] = f(xs[i], z_sin, z_cos, vertical, flip);
+}
+
 static std::vector<Vec2d> make_one_period(double width, double scaleFactor, double z_cos, double z_sin, bool vertical, bool flip, double tolerance)
 {
     std::vector<Vec2d> points;
@@ -75,33 +91,99 @@ static std::vector<Vec2d> make_one_period(double width, double scaleFactor, doub
     points.emplace_back(Vec2d(limit, f(limit, z_sin, z_cos, vertical, flip)));
 
     // piecewise increase in resolution up to requested tolerance
+    std::vector<double> xs, ys;
+    std::vector<Vec2d>  refined;
     for(;;)
     {
-        size_t size = points.size();
-        for (unsigned int i = 1;i < size; ++i) {
-            auto& lp = points[i-1]; // left point
-            auto& rp = points[i];   // right point
-            double x = lp(0) + (rp(0) - lp(0)) / 2;
-            double y = f(x, z_sin, z_cos, vertical, flip);
-            Vec2d ip = {x, y};
-            if (std::abs(cross2(Vec2d(ip - lp), Vec2d(ip - rp))) > sqr(tolerance)) {
-                points.emplace_back(std::move(ip));
-            }
+        // Evaluate the midpoints of all the segments at once.
+        xs.clear();
+        for (size_t i = 1; i < points.size(); ++ i)
+            xs.emplace_back(points[i - 1].x() + (points[i].x() - points[i - 1].x()) / 2);
+        f(xs, ys, z_sin, z_cos, vertical, flip);
+
+        // Insert the midpoints deviating from their segments, keeping the points sorted by x.
+        refined.clear();
+        refined.reserve(2 * points.size());
+        refined.emplace_back(points.front());
+        for (size_t i = 1; i < points.size(); ++ i) {
+            const Vec2d &lp = points[i - 1]; // left point
+            const Vec2d &rp = points[i];     // right point
+            Vec2d ip = { xs[i - 1], ys[i - 1] };
+            if (std::abs(cross2(Vec2d(ip - lp), Vec2d(ip - rp))) > sqr(tolerance))
+                refined.emplace_back(ip);
+            refined.emplace_back(rp);
         }
 
-        if (size == points.size())
+        if (refined.size() == points.size())
             break;
-        else
-        {
-            // insert new points in order
-            std::sort(points.begin(), points.end(),
-                      [](const Vec2d &lhs, const Vec2d &rhs) { return lhs(0) < rhs(0); });
-        }
+        points.swap(refined);
     }
 
     return points;
 }
 
+// One period of the odd and the even waves.
+struct GyroidPeriods
+{
+    std::vector<Vec2d> odd;
+    std::vector<Vec2d> even;
+};
+
+// The periods only depend on the Z of the layer, on the spacing and density of the infill, and on the width of the pattern
+// if it is narrower than a single period. They are shared by all the islands and regions of a layer infilled with the same
+// spacing and density, and by the objects printing a layer at the same Z, thus they are cached.
+// The periods are in the pattern coordinate system, the rotation of the pattern does not matter.
+class GyroidPeriodsCache
+{
+public:
+    static GyroidPeriodsCache& instance() { static GyroidPeriodsCache cache; return cache; }
+
+    std::shared_ptr<const GyroidPeriods> get(double z, double scale_factor, double limit, double tolerance,
+        const std::function<GyroidPeriods()> &calculate)
+    {
+        const Key key { z, scale_factor, limit, tolerance };
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if (auto it = m_map.find(key); it != m_map.end())
+                return it->second;
+        }
+        // Calculate outside of the lock. Two threads may calculate the same periods, the first one is kept.
+        auto periods = std::make_shared<const GyroidPeriods>(calculate());
+        std::lock_guard<std::mutex> lock(m_mutex);
+        auto [it, inserted] = m_map.emplace(key, periods);
+        if (inserted) {
+            m_fifo.emplace_back(key);
+            if (m_fifo.size() > MAX_ENTRIES) {
+                m_map.erase(m_fifo.front());
+                m_fifo.pop_front();
+            }
+        }
+        return it->second;
+    }
+
+private:
+    // Enough for the layers being filled concurrently by all the threads.
+    static constexpr const size_t MAX_ENTRIES = 256;
+
+    struct Key {
+        double z, scale_factor, limit, tolerance;
+        bool operator==(const Key &rhs) const { return z == rhs.z && scale_factor == rhs.scale_factor && limit == rhs.limit && tolerance == rhs.tolerance; }
+    };
+    struct KeyHash {
+        size_t operator()(const Key &key) const {
+            size_t seed = std::hash<double>()(key.z);
+            boost::hash_combine(seed, key.scale_factor);
+            boost::hash_combine(seed, key.limit);
+            boost::hash_combine(seed, key.tolerance);
+            return seed;
+        }
+    };
+
+    std::mutex                                                                  m_mutex;
+    std::unordered_map<Key, std::shared_ptr<const GyroidPeriods>, KeyHash>      m_map;
+    std::deque<Key>                                                             m_fifo;
+};
+
 static Polylines make_gyroid_waves(double gridZ, double density_adjusted, double line_spacing, double width, double height)
 {
     const double scaleFactor = scale_(line_spacing) / density_adjusted;
@@ -127,9 +209,16 @@ static Polylines make_gyroid_waves(double gridZ, double density_adjusted, double
         std::swap(width,height);
     }
 
-    std::vector<Vec2d> one_period_odd = make_one_period(width, scaleFactor, z_cos, z_sin, vertical, flip, tolerance); // creates one period of the waves, so it doesn't have to be recalculated all the time
-    flip = !flip;                                                                   // even polylines are a bit shifted
-    std::vector<Vec2d> one_period_even = make_one_period(width, scaleFactor, z_cos, z_sin, vertical, flip, tolerance);
+    // creates one period of the waves, so it doesn't have to be recalculated all the time
+    std::shared_ptr<const GyroidPeriods> periods = GyroidPeriodsCache::instance().get(gridZ, scaleFactor, std::min(2*M_PI, width), tolerance,
+        [width, scaleFactor, z_cos, z_sin, vertical, flip, tolerance]() {
+            // even polylines are a bit shifted
+            return GyroidPeriods{ make_one_period(width, scaleFactor, z_cos, z_sin, vertical, flip, tolerance),
+                                  make_one_period(width, scaleFactor, z_cos, z_sin, vertical, ! flip, tolerance) };
+        });
+    const std::vector<Vec2d> &one_period_odd  = periods->odd;
+    const std::vector<Vec2d> &one_period_even = periods->even;
+    flip = !flip;
     Polylines result;
 
     for (double y0 = lower_bound; y0 < upper_bound + EPSILON; y0 += M_PI) {
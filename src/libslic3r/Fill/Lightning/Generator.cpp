@@ -123,8 +123,8 @@ Generator::Generator(PrintObject* m_object, std::vector<Polygons>& contours, std
     //for (size_t i = 0; i < overhangs.size(); i++)
     //{
     //    auto svg = draw_two_overhangs_to_svg(i, to_expolygons(contours[i]), to_expolygons(overhangs[i]));
-    //    for (auto& root : m_lightning_layers[i].tree_roots)
-    //        root->draw_tree(svg);
+    //    for (NodeIdx root : m_lightning_layers[i].tree_roots)
+    //        m_lightning_layers[i].nodes.draw_tree(root, svg);
     //}
 }
 
@@ -186,7 +186,7 @@ void Generator::generateTrees(const PrintObject &print_object, const std::functi
         bboxs[layer_id] = get_extents(current_outlines);
 
         // register all trees propagated from the previous layer as to-be-reconnected
-        std::vector<NodeSPtr> to_be_reconnected_tree_roots = current_lightning_layer.tree_roots;
+        std::vector<NodeIdx> to_be_reconnected_tree_roots = current_lightning_layer.tree_roots;
 
         current_lightning_layer.generateNewTrees(m_overhang_per_layer[layer_id], current_outlines, current_outlines_bbox, outlines_locator, m_supporting_radius, m_wall_supporting_radius, throw_on_cancel_callback);
         current_lightning_layer.reconnectRoots(to_be_reconnected_tree_roots, current_outlines, current_outlines_bbox, outlines_locator, m_supporting_radius, m_wall_supporting_radius);
@@ -201,14 +201,12 @@ void Generator::generateTrees(const PrintObject &print_object, const std::functi
             below_outlines_bbox.merge(outlines_locator_bbox);
 
         if (!current_lightning_layer.tree_roots.empty())
-            below_outlines_bbox.merge(get_extents(current_lightning_layer.tree_roots).inflated(SCALED_EPSILON));
+            below_outlines_bbox.merge(get_extents(current_lightning_layer).inflated(SCALED_EPSILON));
 
         outlines_locator.set_bbox(below_outlines_bbox);
         outlines_locator.create(below_outlines, locator_cell_size);
 
-        std::vector<NodeSPtr>& lower_trees = m_lightning_layers[layer_id - 1].tree_roots;
-        for (auto& tree : current_lightning_layer.tree_roots)
-            tree->propagateToNextLayer(lower_trees, below_outlines, outlines_locator, m_prune_length, m_straightening_max_distance, locator_cell_size / 2);
+        current_lightning_layer.propagateToNextLayer(m_lightning_layers[layer_id - 1], below_outlines, outlines_locator, m_prune_length, m_straightening_max_distance, locator_cell_size / 2);
     }
 }
 
@@ -234,7 +232,7 @@ void Generator::generateTreesforSupport(std::vector<Polygons>& contours, const s
         bboxs[layer_id] = get_extents(current_outlines);
 
         // register all trees propagated from the previous layer as to-be-reconnected
-        std::vector<NodeSPtr> to_be_reconnected_tree_roots = current_lightning_layer.tree_roots;
+        std::vector<NodeIdx> to_be_reconnected_tree_roots = current_lightning_layer.tree_roots;
 
         current_lightning_layer.generateNewTrees(m_overhang_per_layer[layer_id], current_outlines, current_outlines_bbox, outlines_locator, m_supporting_radius, m_wall_supporting_radius, throw_on_cancel_callback);
         current_lightning_layer.reconnectRoots(to_be_reconnected_tree_roots, current_outlines, current_outlines_bbox, outlines_locator, m_supporting_radius, m_wall_supporting_radius);
@@ -249,14 +247,12 @@ void Generator::generateTreesforSupport(std::vector<Polygons>& contours, const s
             below_outlines_bbox.merge(outlines_locator_bbox);
 
         if (!current_lightning_layer.tree_roots.empty())
-            below_outlines_bbox.merge(get_extents(current_lightning_layer.tree_roots).inflated(SCALED_EPSILON));
+            below_outlines_bbox.merge(get_extents(current_lightning_layer).inflated(SCALED_EPSILON));
 
         outlines_locator.set_bbox(below_outlines_bbox);
         outlines_locator.create(below_outlines, locator_cell_size);
 
-        std::vector<NodeSPtr>& lower_trees = m_lightning_layers[layer_id - 1].tree_roots;
-        for (auto& tree : current_lightning_layer.tree_roots)
-            tree->propagateToNextLayer(lower_trees, below_outlines, outlines_locator, m_prune_length, m_straightening_max_distance, locator_cell_size / 2);
+        current_lightning_layer.propagateToNextLayer(m_lightning_layers[layer_id - 1], below_outlines, outlines_locator, m_prune_length, m_straightening_max_distance, locator_cell_size / 2);
     }
 }
 
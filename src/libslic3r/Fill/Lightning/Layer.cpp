@@ -21,24 +21,57 @@ coord_t Layer::getWeightedDistance(const Point& boundary_loc, const Point& unsup
     return coord_t((boundary_loc - unsupported_location).cast<double>().norm());
 }
 
-Point GroundingLocation::p() const
+Point GroundingLocation::p(const NodeArena &nodes) const
 {
-    assert(tree_node || boundary_location);
-    return tree_node ? tree_node->getLocation() : *boundary_location;
+    assert(tree_node != NoNode || boundary_location);
+    return tree_node != NoNode ? nodes.getLocation(tree_node) : *boundary_location;
 }
 
-inline static Point to_grid_point(const Point &point, const BoundingBox &bbox)
+NodeGrid::NodeGrid(const BoundingBox &bbox, size_t num_nodes_expected) :
+    m_origin(bbox.min), m_cells(Point(0, 0), this->address(bbox.max))
 {
-    return (point - bbox.min) / locator_cell_size;
+    m_cols = size_t(m_cells.max.x() - m_cells.min.x() + 1);
+    m_heads.assign(m_cols * size_t(m_cells.max.y() - m_cells.min.y() + 1), NoNode);
+    m_next.assign(num_nodes_expected, NoNode);
 }
 
-void Layer::fillLocator(SparseNodeGrid &tree_node_locator, const BoundingBox& current_outlines_bbox)
+void NodeGrid::insert(NodeIdx node, const Point &location)
 {
-    std::function<void(NodeSPtr)> add_node_to_locator_func = [&tree_node_locator, &current_outlines_bbox](const NodeSPtr &node) {
-        tree_node_locator.insert(std::make_pair(to_grid_point(node->getLocation(), current_outlines_bbox), node));
-    };
-    for (auto& tree : tree_roots)
-        tree->visitNodes(add_node_to_locator_func);
+    const Point addr = this->address(location);
+    if (addr.x() < m_cells.min.x() || addr.x() > m_cells.max.x() || addr.y() < m_cells.min.y() || addr.y() > m_cells.max.y())
+        this->grow(addr);
+    if (node >= m_next.size())
+        m_next.resize(std::max(size_t(node) + 1, 2 * m_next.size()), NoNode);
+    NodeIdx &head = m_heads[this->cell_idx(addr)];
+    m_next[node] = head;
+    head = node;
+}
+
+void NodeGrid::grow(const Point &addr)
+{
+    // Leave some room around the new cell, nodes outside of the layer bounding box usually come in bunches.
+    constexpr coord_t margin = 4;
+    BoundingBox cells = m_cells;
+    if (addr.x() < cells.min.x()) cells.min.x() = addr.x() - margin;
+    if (addr.y() < cells.min.y()) cells.min.y() = addr.y() - margin;
+    if (addr.x() > cells.max.x()) cells.max.x() = addr.x() + margin;
+    if (addr.y() > cells.max.y()) cells.max.y() = addr.y() + margin;
+
+    // The chains of nodes are kept, only their heads are moved.
+    const size_t         cols = size_t(cells.max.x() - cells.min.x() + 1);
+    std::vector<NodeIdx> heads(cols * size_t(cells.max.y() - cells.min.y() + 1), NoNode);
+    for (coord_t y = m_cells.min.y(); y <= m_cells.max.y(); ++ y)
+        std::copy_n(m_heads.begin() + this->cell_idx({ m_cells.min.x(), y }), m_cols,
+                    heads.begin() + size_t(y - cells.min.y()) * cols + size_t(m_cells.min.x() - cells.min.x()));
+    m_cells = cells;
+    m_cols  = cols;
+    m_heads = std::move(heads);
+}
+
+void Layer::fillLocator(NodeGrid &tree_node_locator) const
+{
+    for (NodeIdx tree : tree_roots)
+        nodes.visitNodes(tree, [this, &tree_node_locator](NodeIdx node) { tree_node_locator.insert(node, nodes.getLocation(node)); });
 }
 
 void Layer::generateNewTrees
@@ -55,8 +88,8 @@ void Layer::generateNewTrees
     DistanceField distance_field(supporting_radius, current_outlines, current_outlines_bbox, current_overhang);
     throw_on_cancel_callback();
 
-    SparseNodeGrid tree_node_locator;
-    fillLocator(tree_node_locator, current_outlines_bbox);
+    NodeGrid tree_node_locator(current_outlines_bbox, nodes.size());
+    fillLocator(tree_node_locator);
 
     // Until no more points need to be added to support all:
     // Determine next point from tree/outline areas via distance-field
@@ -65,22 +98,22 @@ void Layer::generateNewTrees
     while (distance_field.tryGetNextPoint(&unsupported_location, &unsupported_cell_idx, unsupported_cell_idx)) {
         throw_on_cancel_callback();
         GroundingLocation grounding_loc = getBestGroundingLocation(
-            unsupported_location, current_outlines, current_outlines_bbox, outlines_locator, supporting_radius, wall_supporting_radius, tree_node_locator);
+            unsupported_location, current_outlines, outlines_locator, supporting_radius, wall_supporting_radius, tree_node_locator);
 
-        NodeSPtr new_parent;
-        NodeSPtr new_child;
+        NodeIdx new_parent = NoNode;
+        NodeIdx new_child  = NoNode;
         this->attach(unsupported_location, grounding_loc, new_child, new_parent);
-        tree_node_locator.insert(std::make_pair(to_grid_point(new_child->getLocation(), current_outlines_bbox), new_child));
-        if (new_parent)
-            tree_node_locator.insert(std::make_pair(to_grid_point(new_parent->getLocation(), current_outlines_bbox), new_parent));
+        tree_node_locator.insert(new_child, nodes.getLocation(new_child));
+        if (new_parent != NoNode)
+            tree_node_locator.insert(new_parent, nodes.getLocation(new_parent));
         // update distance field
-        distance_field.update(grounding_loc.p(), unsupported_location);
+        distance_field.update(grounding_loc.p(nodes), unsupported_location);
     }
 
 #ifdef LIGHTNING_TREE_NODE_DEBUG_OUTPUT
     {
         static int iRun = 0;
-        export_to_svg(debug_out_path("FillLightning-TreeNodes-%d.svg", iRun++), current_outlines, this->tree_roots);
+        export_to_svg(debug_out_path("FillLightning-TreeNodes-%d.svg", iRun++), current_outlines, this->nodes, this->tree_roots);
     }
 #endif /* LIGHTNING_TREE_NODE_DEBUG_OUTPUT */
 }
@@ -118,12 +151,11 @@ GroundingLocation Layer::getBestGroundingLocation
 (
     const Point& unsupported_location,
     const Polygons& current_outlines,
-    const BoundingBox& current_outlines_bbox,
     const EdgeGrid::Grid& outline_locator,
     const coord_t supporting_radius,
     const coord_t wall_supporting_radius,
-    const SparseNodeGrid& tree_node_locator,
-    const NodeSPtr& exclude_tree
+    const NodeGrid& tree_node_locator,
+    const NodeIdx exclude_tree
 )
 {
     // Closest point on current_outlines to unsupported_location:
@@ -146,80 +178,82 @@ GroundingLocation Layer::getBestGroundingLocation
 
     const auto within_dist = coord_t((node_location - unsupported_location).cast<double>().norm());
 
-    NodeSPtr sub_tree{nullptr};
+    NodeIdx  sub_tree = NoNode;
     coord_t  current_dist = getWeightedDistance(node_location, unsupported_location);
     if (current_dist >= wall_supporting_radius) { // Only reconnect tree roots to other trees if they are not already close to the outlines.
         const coord_t search_radius = std::min(current_dist, within_dist);
         BoundingBox region(unsupported_location - Point(search_radius, search_radius), unsupported_location + Point(search_radius + locator_cell_size, search_radius + locator_cell_size));
-        region.min = to_grid_point(region.min, current_outlines_bbox);
-        region.max = to_grid_point(region.max, current_outlines_bbox);
+        region.min = tree_node_locator.address(region.min);
+        region.max = tree_node_locator.address(region.max);
+        // Cells outside of the grid are empty.
+        region.min = region.min.cwiseMax(tree_node_locator.cells().min);
+        region.max = region.max.cwiseMin(tree_node_locator.cells().max + Point(1, 1));
 
         Point      current_dist_grid_addr{std::numeric_limits<coord_t>::lowest(), std::numeric_limits<coord_t>::lowest()};
         std::mutex current_dist_mutex;
-        tbb::parallel_for(tbb::blocked_range2d<coord_t>(region.min.y(), region.max.y(), region.min.x(), region.max.x()), [&current_dist, current_dist_copy = current_dist, &current_dist_mutex, &sub_tree, &current_dist_grid_addr, &exclude_tree = std::as_const(exclude_tree), &outline_locator = std::as_const(outline_locator), &supporting_radius = std::as_const(supporting_radius), &tree_node_locator = std::as_const(tree_node_locator), &unsupported_location = std::as_const(unsupported_location)](const tbb::blocked_range2d<coord_t> &range) -> void {
-            for (coord_t grid_addr_y = range.rows().begin(); grid_addr_y < range.rows().end(); ++grid_addr_y)
-                for (coord_t grid_addr_x = range.cols().begin(); grid_addr_x < range.cols().end(); ++grid_addr_x) {
-                    const Point local_grid_addr{grid_addr_x, grid_addr_y};
-                    NodeSPtr    local_sub_tree{nullptr};
-                    coord_t     local_current_dist = current_dist_copy;
-                    const auto  it_range           = tree_node_locator.equal_range(local_grid_addr);
-                    for (auto it = it_range.first; it != it_range.second; ++it) {
-                        const NodeSPtr candidate_sub_tree = it->second.lock();
-                        if ((candidate_sub_tree && candidate_sub_tree != exclude_tree) &&
-                            !(exclude_tree && exclude_tree->hasOffspring(candidate_sub_tree)) &&
-                            !polygonCollidesWithLineSegment(unsupported_location, candidate_sub_tree->getLocation(), outline_locator)) {
-                            if (const coord_t candidate_dist = candidate_sub_tree->getWeightedDistance(unsupported_location, supporting_radius); candidate_dist < local_current_dist) {
-                                local_current_dist = candidate_dist;
-                                local_sub_tree     = candidate_sub_tree;
+        if (region.min.x() < region.max.x() && region.min.y() < region.max.y()) {
+            tbb::parallel_for(tbb::blocked_range2d<coord_t>(region.min.y(), region.max.y(), region.min.x(), region.max.x()), [&current_dist, current_dist_copy = current_dist, &current_dist_mutex, &sub_tree, &current_dist_grid_addr, exclude_tree, &nodes = std::as_const(nodes), &outline_locator = std::as_const(outline_locator), &supporting_radius = std::as_const(supporting_radius), &tree_node_locator = std::as_const(tree_node_locator), &unsupported_location = std::as_const(unsupported_location)](const tbb::blocked_range2d<coord_t> &range) -> void {
+                for (coord_t grid_addr_y = range.rows().begin(); grid_addr_y < range.rows().end(); ++grid_addr_y)
+                    for (coord_t grid_addr_x = range.cols().begin(); grid_addr_x < range.cols().end(); ++grid_addr_x) {
+                        const Point local_grid_addr{grid_addr_x, grid_addr_y};
+                        NodeIdx     local_sub_tree     = NoNode;
+                        coord_t     local_current_dist = current_dist_copy;
+                        tree_node_locator.visit_cell(local_grid_addr, [&](const NodeIdx candidate_sub_tree) {
+                            if ((exclude_tree == NoNode || ! nodes.hasOffspring(exclude_tree, candidate_sub_tree)) &&
+                                !polygonCollidesWithLineSegment(unsupported_location, nodes.getLocation(candidate_sub_tree), outline_locator)) {
+                                if (const coord_t candidate_dist = nodes.getWeightedDistance(candidate_sub_tree, unsupported_location, supporting_radius); candidate_dist < local_current_dist) {
+                                    local_current_dist = candidate_dist;
+                                    local_sub_tree     = candidate_sub_tree;
+                                }
+                            }
+                        });
+                        // To always get the same result in a parallel version as in a non-parallel version,
+                        // we need to preserve that for the same current_dist, we select the same sub_tree
+                        // as in the non-parallel version. For this purpose, inside the variable
+                        // current_dist_grid_addr is stored from with 2D grid position assigned sub_tree comes.
+                        // And when there are two sub_tree with the same current_dist, one which will be found
+                        // the first in the non-parallel version is selected.
+                        {
+                            std::lock_guard<std::mutex> lock(current_dist_mutex);
+                            if (local_current_dist < current_dist ||
+                                (local_current_dist == current_dist && (grid_addr_y < current_dist_grid_addr.y() ||
+                                  (grid_addr_y == current_dist_grid_addr.y() && grid_addr_x < current_dist_grid_addr.x())))) {
+                                current_dist           = local_current_dist;
+                                sub_tree               = local_sub_tree;
+                                current_dist_grid_addr = local_grid_addr;
                             }
                         }
                     }
-                    // To always get the same result in a parallel version as in a non-parallel version,
-                    // we need to preserve that for the same current_dist, we select the same sub_tree
-                    // as in the non-parallel version. For this purpose, inside the variable
-                    // current_dist_grid_addr is stored from with 2D grid position assigned sub_tree comes.
-                    // And when there are two sub_tree with the same current_dist, one which will be found
-                    // the first in the non-parallel version is selected.
-                    {
-                        std::lock_guard<std::mutex> lock(current_dist_mutex);
-                        if (local_current_dist < current_dist ||
-                            (local_current_dist == current_dist && (grid_addr_y < current_dist_grid_addr.y() ||
-                              (grid_addr_y == current_dist_grid_addr.y() && grid_addr_x < current_dist_grid_addr.x())))) {
-                            current_dist           = local_current_dist;
-                            sub_tree               = local_sub_tree;
-                            current_dist_grid_addr = local_grid_addr;
-                        }
-                    }
-                }
-        }); // end of parallel_for
+            }); // end of parallel_for
+        }
     }
 
-    return ! sub_tree ?
-        GroundingLocation{ nullptr, node_location } :
+    return sub_tree == NoNode ?
+        GroundingLocation{ NoNode, node_location } :
         GroundingLocation{ sub_tree, std::optional<Point>() };
 }
 
 bool Layer::attach(
     const Point& unsupported_location,
     const GroundingLocation& grounding_loc,
-    NodeSPtr& new_child,
-    NodeSPtr& new_root)
+    NodeIdx& new_child,
+    NodeIdx& new_root)
 {
     // Update trees & distance fields.
     if (grounding_loc.boundary_location) {
-        new_root = Node::create(grounding_loc.p(), std::make_optional(grounding_loc.p()));
-        new_child = new_root->addChild(unsupported_location);
+        new_root = nodes.create(*grounding_loc.boundary_location, grounding_loc.boundary_location);
+        new_child = nodes.addChild(new_root, unsupported_location);
         tree_roots.push_back(new_root);
         return true;
     } else {
-        new_child = grounding_loc.tree_node->addChild(unsupported_location);
+        new_child = nodes.addChild(grounding_loc.tree_node, unsupported_location);
         return false;
     }
 }
 
 void Layer::reconnectRoots
 (
-    std::vector<NodeSPtr>& to_be_reconnected_tree_roots,
+    const std::vector<NodeIdx>& to_be_reconnected_tree_roots,
     const Polygons& current_outlines,
     const BoundingBox& current_outlines_bbox,
     const EdgeGrid::Grid& outline_locator,
@@ -229,29 +263,30 @@ void Layer::reconnectRoots
 {
     constexpr coord_t tree_connecting_ignore_offset = 100;
 
-    SparseNodeGrid tree_node_locator;
-    fillLocator(tree_node_locator, current_outlines_bbox);
+    NodeGrid tree_node_locator(current_outlines_bbox, nodes.size());
+    fillLocator(tree_node_locator);
 
     const coord_t within_max_dist = outline_locator.resolution() * 2;
-    for (const auto &root_ptr : to_be_reconnected_tree_roots)
+    for (const NodeIdx root : to_be_reconnected_tree_roots)
     {
-        auto old_root_it = std::find(tree_roots.begin(), tree_roots.end(), root_ptr);
+        auto old_root_it = std::find(tree_roots.begin(), tree_roots.end(), root);
 
-        if (root_ptr->getLastGroundingLocation())
+        // Copy, creating a node may reallocate the arena.
+        if (const std::optional<Point> last_grounding_location = nodes.getLastGroundingLocation(root); last_grounding_location)
         {
-            const Point& ground_loc = *root_ptr->getLastGroundingLocation();
-            if (ground_loc != root_ptr->getLocation())
+            const Point& ground_loc = *last_grounding_location;
+            if (ground_loc != nodes.getLocation(root))
             {
                 Point new_root_pt;
-                // Find an intersection of the line segment from root_ptr->getLocation() to ground_loc, at within_max_dist from ground_loc.
-                if (lineSegmentPolygonsIntersection(root_ptr->getLocation(), ground_loc, outline_locator, new_root_pt, within_max_dist)) {
-                    auto new_root = Node::create(new_root_pt, new_root_pt);
-                    root_ptr->addChild(new_root);
-                    new_root->reroot();
+                // Find an intersection of the line segment from root->getLocation() to ground_loc, at within_max_dist from ground_loc.
+                if (lineSegmentPolygonsIntersection(nodes.getLocation(root), ground_loc, outline_locator, new_root_pt, within_max_dist)) {
+                    NodeIdx new_root = nodes.create(new_root_pt, new_root_pt);
+                    nodes.addChild(root, new_root);
+                    nodes.reroot(new_root);
 
-                    tree_node_locator.insert(std::make_pair(to_grid_point(new_root->getLocation(), current_outlines_bbox), new_root));
+                    tree_node_locator.insert(new_root, new_root_pt);
 
-                    *old_root_it = std::move(new_root); // replace old root with new root
+                    *old_root_it = new_root; // replace old root with new root
                     continue;
                 }
             }
@@ -261,48 +296,64 @@ void Layer::reconnectRoots
         GroundingLocation ground =
             getBestGroundingLocation
             (
-                root_ptr->getLocation(),
+                nodes.getLocation(root),
                 current_outlines,
-                current_outlines_bbox,
                 outline_locator,
                 supporting_radius,
                 tree_connecting_ignore_width,
                 tree_node_locator,
-                root_ptr
+                root
             );
         if (ground.boundary_location)
         {
-            if (*ground.boundary_location == root_ptr->getLocation())
+            if (*ground.boundary_location == nodes.getLocation(root))
                 continue; // Already on the boundary.
 
-            auto new_root = Node::create(ground.p(), ground.p());
-            auto attach_ptr = root_ptr->closestNode(new_root->getLocation());
-            attach_ptr->reroot();
+            const Point new_root_pt = *ground.boundary_location;
+            NodeIdx new_root   = nodes.create(new_root_pt, new_root_pt);
+            NodeIdx attach_idx = nodes.closestNode(root, new_root_pt);
+            nodes.reroot(attach_idx);
 
-            new_root->addChild(attach_ptr);
-            tree_node_locator.insert(std::make_pair(to_grid_point(new_root->getLocation(), current_outlines_bbox), new_root));
+            nodes.addChild(new_root, attach_idx);
+            tree_node_locator.insert(new_root, new_root_pt);
 
-            *old_root_it = std::move(new_root); // replace old root with new root
+            *old_root_it = new_root; // replace old root with new root
         }
         else
         {
-            assert(ground.tree_node);
-            assert(ground.tree_node != root_ptr);
-            assert(!root_ptr->hasOffspring(ground.tree_node));
-            assert(!ground.tree_node->hasOffspring(root_ptr));
+            assert(ground.tree_node != NoNode);
+            assert(ground.tree_node != root);
+            assert(!nodes.hasOffspring(root, ground.tree_node));
+            assert(!nodes.hasOffspring(ground.tree_node, root));
 
-            auto attach_ptr = root_ptr->closestNode(ground.tree_node->getLocation());
-            attach_ptr->reroot();
+            NodeIdx attach_idx = nodes.closestNode(root, nodes.getLocation(ground.tree_node));
+            nodes.reroot(attach_idx);
 
-            ground.tree_node->addChild(attach_ptr);
+            nodes.addChild(ground.tree_node, attach_idx);
 
             // remove old root
-            *old_root_it = std::move(tree_roots.back());
+            *old_root_it = tree_roots.back();
             tree_roots.pop_back();
         }
     }
 }
 
+void Layer::propagateToNextLayer
+(
+    Layer& layer_below,
+    const Polygons& next_outlines,
+    const EdgeGrid::Grid& outline_locator,
+    const coord_t prune_distance,
+    const coord_t smooth_magnitude,
+    const coord_t max_remove_colinear_dist
+) const
+{
+    // Only the nodes reachable from the roots are copied, the layer below starts with a compact arena.
+    layer_below.nodes.reserve(layer_below.nodes.size() + nodes.size());
+    for (const NodeIdx tree : tree_roots)
+        nodes.propagateToNextLayer(tree, layer_below.nodes, layer_below.tree_roots, next_outlines, outline_locator, prune_distance, smooth_magnitude, max_remove_colinear_dist);
+}
+
 #if 0
 /*!
     * Moves the point \p from onto the nearest polygon or leaves the point as-is, when the comb boundary is not within the root of \p max_dist2 distance.
@@ -439,8 +490,8 @@ Polylines Layer::convertToLines(const Polygons& limit_to_outline, const coord_t
         return {};
 
     Polylines result_lines;
-    for (const auto &tree : tree_roots)
-        tree->convertToPolylines(result_lines, line_overlap);
+    for (const NodeIdx tree : tree_roots)
+        nodes.convertToPolylines(tree, result_lines, line_overlap);
 
     return intersection_pl(result_lines, limit_to_outline);
 }
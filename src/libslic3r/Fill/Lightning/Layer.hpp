@@ -6,25 +6,59 @@
 
 #include "../../EdgeGrid.hpp"
 #include "../../Polygon.hpp"
+#include "TreeNode.hpp"
 
-#include <memory>
 #include <vector>
-#include <list>
-#include <unordered_map>
 #include <optional>
 
 namespace Slic3r::FillLightning
 {
 
-class Node;
-using NodeSPtr = std::shared_ptr<Node>;
-using SparseNodeGrid = std::unordered_multimap<Point, std::weak_ptr<Node>, PointHash>;
+/*!
+ * Flat spatial grid of the tree nodes of a layer, used to find the nodes close to an unsupported location.
+ *
+ * The grid cells are stored densely over the bounding box of the layer. The nodes of a cell are chained
+ * through an array indexed by the node index, thus inserting a node only writes into flat arrays. If a node
+ * falls outside of the grid, the grid grows to cover it.
+ */
+class NodeGrid
+{
+public:
+    NodeGrid(const BoundingBox &bbox, size_t num_nodes_expected);
+
+    // Address of the grid cell containing a point.
+    Point   address(const Point &p) const { return (p - m_origin) / locator_cell_size; }
+    // Range of the cell addresses stored, inclusive.
+    const BoundingBox& cells() const { return m_cells; }
+
+    void    insert(NodeIdx node, const Point &location);
+
+    // Call visitor(NodeIdx) for all nodes inserted into the cell at the given address.
+    template<typename Visitor> void visit_cell(const Point &addr, Visitor &&visitor) const {
+        if (addr.x() < m_cells.min.x() || addr.x() > m_cells.max.x() || addr.y() < m_cells.min.y() || addr.y() > m_cells.max.y())
+            return;
+        for (NodeIdx node = m_heads[this->cell_idx(addr)]; node != NoNode; node = m_next[node])
+            visitor(node);
+    }
+
+private:
+    size_t  cell_idx(const Point &addr) const { return size_t(addr.y() - m_cells.min.y()) * m_cols + size_t(addr.x() - m_cells.min.x()); }
+    void    grow(const Point &addr);
+
+    Point                   m_origin;
+    BoundingBox             m_cells;
+    size_t                  m_cols { 0 };
+    // First node of each cell.
+    std::vector<NodeIdx>    m_heads;
+    // Next node in the same cell, indexed by node.
+    std::vector<NodeIdx>    m_next;
+};
 
 struct GroundingLocation
 {
-    NodeSPtr tree_node; //!< not null if the gounding location is on a tree
+    NodeIdx tree_node { NoNode }; //!< valid if the gounding location is on a tree
     std::optional<Point> boundary_location; //!< in case the gounding location is on the boundary
-    Point p() const;
+    Point p(const NodeArena &nodes) const;
 };
 
 /*!
@@ -35,7 +69,9 @@ struct GroundingLocation
 class Layer
 {
 public:
-    std::vector<NodeSPtr> tree_roots;
+    // Storage of the nodes of all trees of this layer.
+    NodeArena            nodes;
+    std::vector<NodeIdx> tree_roots;
 
     void generateNewTrees
     (
@@ -55,12 +91,11 @@ public:
     (
         const Point& unsupported_location,
         const Polygons& current_outlines,
-        const BoundingBox& current_outlines_bbox,
         const EdgeGrid::Grid& outline_locator,
         coord_t supporting_radius,
         coord_t wall_supporting_radius,
-        const SparseNodeGrid& tree_node_locator,
-        const NodeSPtr& exclude_tree = nullptr
+        const NodeGrid& tree_node_locator,
+        NodeIdx exclude_tree = NoNode
     );
 
     /*!
@@ -68,11 +103,11 @@ public:
      * \param[out] new_root The new root node if one had been made
      * \return Whether a new root was added
      */
-    bool attach(const Point& unsupported_location, const GroundingLocation& ground, NodeSPtr& new_child, NodeSPtr& new_root);
+    bool attach(const Point& unsupported_location, const GroundingLocation& ground, NodeIdx& new_child, NodeIdx& new_root);
 
     void reconnectRoots
     (
-        std::vector<NodeSPtr>& to_be_reconnected_tree_roots,
+        const std::vector<NodeIdx>& to_be_reconnected_tree_roots,
         const Polygons& current_outlines,
         const BoundingBox& current_outlines_bbox,
         const EdgeGrid::Grid& outline_locator,
@@ -80,13 +115,29 @@ public:
         coord_t wall_supporting_radius
     );
 
+    /*!
+     * Copy the trees of this layer into \p layer_below, realign them to its outlines, prune and straighten them.
+     * See NodeArena::propagateToNextLayer().
+     */
+    void propagateToNextLayer
+    (
+        Layer& layer_below,
+        const Polygons& next_outlines,
+        const EdgeGrid::Grid& outline_locator,
+        coord_t prune_distance,
+        coord_t smooth_magnitude,
+        coord_t max_remove_colinear_dist
+    ) const;
+
     Polylines convertToLines(const Polygons& limit_to_outline, coord_t line_overlap) const;
 
     coord_t getWeightedDistance(const Point& boundary_loc, const Point& unsupported_location);
 
-    void fillLocator(SparseNodeGrid& tree_node_locator, const BoundingBox& current_outlines_bbox);
+    void fillLocator(NodeGrid& tree_node_locator) const;
 };
 
+inline BoundingBox get_extents(const Layer &layer) { return get_extents(layer.nodes, layer.tree_roots); }
+
 } // namespace Slic3r::FillLightning
 
 #endif // LIGHTNING_LAYER_H
@@ -7,131 +7,138 @@
 
 namespace Slic3r::FillLightning {
 
-coord_t Node::getWeightedDistance(const Point& unsupported_location, const coord_t& supporting_radius) const
+coord_t NodeArena::getWeightedDistance(const NodeIdx idx, const Point& unsupported_location, const coord_t& supporting_radius) const
 {
     constexpr coord_t min_valence_for_boost = 0;
     constexpr coord_t max_valence_for_boost = 4;
     constexpr coord_t valence_boost_multiplier = 4;
 
-    const size_t valence = (!m_is_root) + m_children.size();
+    const Node &node = (*this)[idx];
+    const size_t valence = (!node.is_root) + node.children.size();
     const coord_t valence_boost = (min_valence_for_boost < valence && valence < max_valence_for_boost) ? valence_boost_multiplier * supporting_radius : 0;
-    const auto dist_here = coord_t((getLocation() - unsupported_location).cast<double>().norm());
+    const auto dist_here = coord_t((node.p - unsupported_location).cast<double>().norm());
     return dist_here - valence_boost;
 }
 
-bool Node::hasOffspring(const NodeSPtr& to_be_checked) const
+bool NodeArena::hasOffspring(const NodeIdx idx, const NodeIdx to_be_checked) const
 {
-    if (to_be_checked == shared_from_this())
-        return true;
-
-    for (auto& child_ptr : m_children)
-        if (child_ptr->hasOffspring(to_be_checked)) 
+    for (NodeIdx ancestor = to_be_checked; ancestor != NoNode; ancestor = (*this)[ancestor].parent)
+        if (ancestor == idx)
             return true;
-
     return false;
 }
 
-NodeSPtr Node::addChild(const Point& child_loc)
+NodeIdx NodeArena::create(const Point &p, const std::optional<Point> &last_grounding_location /*= std::nullopt*/)
+{
+    assert(m_nodes.size() < size_t(NoNode));
+    m_nodes.emplace_back(p, last_grounding_location);
+    return NodeIdx(m_nodes.size() - 1);
+}
+
+NodeIdx NodeArena::addChild(const NodeIdx parent, const Point& child_loc)
 {
-    assert(m_p != child_loc);
-    NodeSPtr child = Node::create(child_loc);
-    return addChild(child);
+    assert(getLocation(parent) != child_loc);
+    return addChild(parent, this->create(child_loc));
 }
 
-NodeSPtr Node::addChild(NodeSPtr& new_child)
+NodeIdx NodeArena::addChild(const NodeIdx parent, const NodeIdx new_child)
 {
-    assert(new_child != shared_from_this());
+    assert(new_child != parent);
     //assert(p != new_child->p); // NOTE: No problem for now. Issue to solve later. Maybe even afetr final. Low prio.
-    m_children.push_back(new_child);
-    new_child->m_parent = shared_from_this();
-    new_child->m_is_root = false;
+    m_nodes[parent].children.push_back(new_child);
+    Node &child   = m_nodes[new_child];
+    child.parent  = parent;
+    child.is_root = false;
     return new_child;
 }
 
-void Node::propagateToNextLayer(
-    std::vector<NodeSPtr>& next_trees,
+void NodeArena::propagateToNextLayer(
+    const NodeIdx root,
+    NodeArena& next_nodes,
+    std::vector<NodeIdx>& next_trees,
     const Polygons& next_outlines,
     const EdgeGrid::Grid& outline_locator,
     const coord_t prune_distance,
     const coord_t smooth_magnitude,
     const coord_t max_remove_colinear_dist) const
 {
-    auto tree_below = deepCopy();
-    tree_below->prune(prune_distance);
-    tree_below->straighten(smooth_magnitude, max_remove_colinear_dist);
-    if (tree_below->realign(next_outlines, outline_locator, next_trees))
+    NodeIdx tree_below = deepCopy(root, next_nodes);
+    next_nodes.prune(tree_below, prune_distance);
+    next_nodes.straighten(tree_below, smooth_magnitude, max_remove_colinear_dist);
+    if (next_nodes.realign(tree_below, next_outlines, outline_locator, next_trees))
         next_trees.push_back(tree_below);
 }
 
 // NOTE: Depth-first, as currently implemented.
 //       Skips the root (because that has no root itself), but all initial nodes will have the root point anyway.
-void Node::visitBranches(const std::function<void(const Point&, const Point&)>& visitor) const
+void NodeArena::visitBranches(const NodeIdx idx, const std::function<void(const Point&, const Point&)>& visitor) const
 {
-    for (const auto& node : m_children) {
-        assert(node->m_parent.lock() == shared_from_this());
-        visitor(m_p, node->m_p);
-        node->visitBranches(visitor);
+    const Node &node = (*this)[idx];
+    for (NodeIdx child : node.children) {
+        assert((*this)[child].parent == idx);
+        visitor(node.p, getLocation(child));
+        visitBranches(child, visitor);
     }
 }
 
 // NOTE: Depth-first, as currently implemented.
-void Node::visitNodes(const std::function<void(NodeSPtr)>& visitor)
+void NodeArena::visitNodes(const NodeIdx idx, const std::function<void(NodeIdx)>& visitor) const
 {
-    visitor(shared_from_this());
-    for (const auto& node : m_children) {
-        assert(node->m_parent.lock() == shared_from_this());
-        node->visitNodes(visitor);
+    visitor(idx);
+    for (NodeIdx child : (*this)[idx].children) {
+        assert((*this)[child].parent == idx);
+        visitNodes(child, visitor);
     }
 }
 
-Node::Node(const Point& p, const std::optional<Point>& last_grounding_location /*= std::nullopt*/) : 
-    m_is_root(true), m_p(p), m_last_grounding_location(last_grounding_location)
-{}
-
-NodeSPtr Node::deepCopy() const
+NodeIdx NodeArena::deepCopy(const NodeIdx idx, NodeArena &dst) const
 {
-    NodeSPtr local_root = Node::create(m_p);
-    local_root->m_is_root = m_is_root;
-    if (m_is_root)
+    assert(&dst != this);
+    const Node &node       = (*this)[idx];
+    const NodeIdx local_root = dst.create(node.p);
     {
-        local_root->m_last_grounding_location = m_last_grounding_location.value_or(m_p);
+        Node &copy   = dst.m_nodes[local_root];
+        copy.is_root = node.is_root;
+        if (node.is_root)
+            copy.last_grounding_location = node.last_grounding_location.value_or(node.p);
+        copy.children.reserve(node.children.size());
     }
-    local_root->m_children.reserve(m_children.size());
-    for (const auto& node : m_children)
-    {
-        NodeSPtr child = node->deepCopy();
-        child->m_parent = local_root;
-        local_root->m_children.push_back(child);
+    for (NodeIdx child : node.children) {
+        // The recursive call may reallocate the destination arena, don't hold references into it.
+        const NodeIdx child_copy = deepCopy(child, dst);
+        dst.m_nodes[child_copy].parent = local_root;
+        dst.m_nodes[local_root].children.push_back(child_copy);
     }
     return local_root;
 }
 
-void Node::reroot(const NodeSPtr &new_parent)
+void NodeArena::reroot(const NodeIdx idx, const NodeIdx new_parent)
 {
-    if (! m_is_root) {
-        auto old_parent = m_parent.lock();
-        old_parent->reroot(shared_from_this());
-        m_children.push_back(old_parent);
+    if (! m_nodes[idx].is_root) {
+        const NodeIdx old_parent = m_nodes[idx].parent;
+        reroot(old_parent, idx);
+        m_nodes[idx].children.push_back(old_parent);
     }
 
-    if (new_parent) {
-        m_children.erase(std::remove(m_children.begin(), m_children.end(), new_parent), m_children.end());
-        m_is_root = false;
-        m_parent = new_parent;
+    Node &node = m_nodes[idx];
+    if (new_parent != NoNode) {
+        node.children.erase(std::remove(node.children.begin(), node.children.end(), new_parent), node.children.end());
+        node.is_root = false;
+        node.parent  = new_parent;
     } else {
-        m_is_root = true;
-        m_parent.reset();
+        node.is_root = true;
+        node.parent  = NoNode;
     }
 }
 
-NodeSPtr Node::closestNode(const Point& loc)
+NodeIdx NodeArena::closestNode(const NodeIdx idx, const Point& loc) const
 {
-    NodeSPtr result = shared_from_this();
-    auto closest_dist2 = coord_t((m_p - loc).cast<double>().norm());
+    NodeIdx result = idx;
+    auto closest_dist2 = coord_t((getLocation(idx) - loc).cast<double>().norm());
 
-    for (const auto& child : m_children) {
-        NodeSPtr candidate_node = child->closestNode(loc);
-        const auto child_dist2 = coord_t((candidate_node->m_p - loc).cast<double>().norm());
+    for (NodeIdx child : (*this)[idx].children) {
+        NodeIdx candidate_node = closestNode(child, loc);
+        const auto child_dist2 = coord_t((getLocation(candidate_node) - loc).cast<double>().norm());
         if (child_dist2 < closest_dist2) {
             closest_dist2 = child_dist2;
             result = candidate_node;
@@ -187,52 +194,57 @@ bool lineSegmentPolygonsIntersection(const Point& a, const Point& b, const EdgeG
     return false;
 }
 
-bool Node::realign(const Polygons& outlines, const EdgeGrid::Grid& outline_locator, std::vector<NodeSPtr>& rerooted_parts)
+// None of the functions below allocate nodes, therefore references to the nodes stay valid during the recursion.
+bool NodeArena::realign(const NodeIdx idx, const Polygons& outlines, const EdgeGrid::Grid& outline_locator, std::vector<NodeIdx>& rerooted_parts)
 {
     if (outlines.empty())
         return false;
 
-    if (inside(outlines, m_p)) {
+    Node &node = m_nodes[idx];
+    if (inside(outlines, node.p)) {
         // Only keep children that have an unbroken connection to here, realign will put the rest in rerooted parts due to recursion:
         Point coll;
         bool reground_me = false;
-        m_children.erase(std::remove_if(m_children.begin(), m_children.end(), [&](const NodeSPtr &child) {
-            bool connect_branch = child->realign(outlines, outline_locator, rerooted_parts);
+        node.children.erase(std::remove_if(node.children.begin(), node.children.end(), [&](const NodeIdx child_idx) {
+            bool connect_branch = realign(child_idx, outlines, outline_locator, rerooted_parts);
+            Node &child = m_nodes[child_idx];
             // Find an intersection of the line segment from p to child->p, at maximum outline_locator.resolution() * 2 distance from p.
-            if (connect_branch && lineSegmentPolygonsIntersection(child->m_p, m_p, outline_locator, coll, outline_locator.resolution() * 2)) {
-                child->m_last_grounding_location.reset();
-                child->m_parent.reset();
-                child->m_is_root = true;
-                rerooted_parts.push_back(child);
+            if (connect_branch && lineSegmentPolygonsIntersection(child.p, node.p, outline_locator, coll, outline_locator.resolution() * 2)) {
+                child.last_grounding_location.reset();
+                child.parent  = NoNode;
+                child.is_root = true;
+                rerooted_parts.push_back(child_idx);
                 reground_me = true;
                 connect_branch = false;
             }
             return ! connect_branch;
-        }), m_children.end());
+        }), node.children.end());
         if (reground_me)
-            m_last_grounding_location.reset();
+            node.last_grounding_location.reset();
         return true;
     }
 
     // 'Lift' any decendants out of this tree:
-    for (auto& child : m_children)
-        if (child->realign(outlines, outline_locator, rerooted_parts)) {
-            child->m_last_grounding_location = m_p;
-            child->m_parent.reset();
-            child->m_is_root = true;
-            rerooted_parts.push_back(child);
+    for (NodeIdx child_idx : node.children)
+        if (realign(child_idx, outlines, outline_locator, rerooted_parts)) {
+            Node &child = m_nodes[child_idx];
+            child.last_grounding_location = node.p;
+            child.parent  = NoNode;
+            child.is_root = true;
+            rerooted_parts.push_back(child_idx);
         }
 
-    m_children.clear();
+    node.children.clear();
     return false;
 }
 
-void Node::straighten(const coord_t magnitude, const coord_t max_remove_colinear_dist)
+void NodeArena::straighten(const NodeIdx idx, const coord_t magnitude, const coord_t max_remove_colinear_dist)
 {
-    straighten(magnitude, m_p, 0, int64_t(max_remove_colinear_dist) * int64_t(max_remove_colinear_dist));
+    straighten(idx, magnitude, getLocation(idx), 0, int64_t(max_remove_colinear_dist) * int64_t(max_remove_colinear_dist));
 }
 
-Node::RectilinearJunction Node::straighten(
+NodeArena::RectilinearJunction NodeArena::straighten(
+    const NodeIdx idx,
     const coord_t magnitude,
     const Point& junction_above,
     const coord_t accumulated_dist,
@@ -242,11 +254,12 @@ Node::RectilinearJunction Node::straighten(
     constexpr coord_t junction_magnitude_factor_denominator = 4;
 
     const coord_t junction_magnitude = magnitude * junction_magnitude_factor_numerator / junction_magnitude_factor_denominator;
-    if (m_children.size() == 1)
+    Node &node = m_nodes[idx];
+    if (node.children.size() == 1)
     {
-        auto child_p = m_children.front();
-        auto child_dist = coord_t((m_p - child_p->m_p).cast<double>().norm());
-        RectilinearJunction junction_below = child_p->straighten(magnitude, junction_above, accumulated_dist + child_dist, max_remove_colinear_dist2);
+        NodeIdx child_idx = node.children.front();
+        auto child_dist = coord_t((node.p - m_nodes[child_idx].p).cast<double>().norm());
+        RectilinearJunction junction_below = straighten(child_idx, magnitude, junction_above, accumulated_dist + child_dist, max_remove_colinear_dist2);
         coord_t total_dist_to_junction_below = junction_below.total_recti_dist;
         const Point& a = junction_above;
         Point        b = junction_below.junction_loc;
@@ -254,26 +267,28 @@ Node::RectilinearJunction Node::straighten(
         {
             Point ab = b - a;
             Point destination = (a.cast<int64_t>() + ab.cast<int64_t>() * int64_t(accumulated_dist) / std::max(int64_t(1), int64_t(total_dist_to_junction_below))).cast<coord_t>();
-            if ((destination - m_p).cast<int64_t>().squaredNorm() <= int64_t(magnitude) * int64_t(magnitude))
-                m_p = destination;
+            if ((destination - node.p).cast<int64_t>().squaredNorm() <= int64_t(magnitude) * int64_t(magnitude))
+                node.p = destination;
             else
-                m_p += ((destination - m_p).cast<double>().normalized() * magnitude).cast<coord_t>();
+                node.p += ((destination - node.p).cast<double>().normalized() * magnitude).cast<coord_t>();
         }
         { // remove nodes on linear segments
             constexpr coord_t close_enough = 10;
 
-            child_p = m_children.front(); //recursive call to straighten might have removed the child
-            const NodeSPtr& parent_node = m_parent.lock();
-            if (parent_node &&
-                (child_p->m_p - parent_node->m_p).cast<int64_t>().squaredNorm() < max_remove_colinear_dist2 &&
-                Line::distance_to_squared(m_p, parent_node->m_p, child_p->m_p) < close_enough * close_enough) {
-                child_p->m_parent = m_parent;
-                for (auto& sibling : parent_node->m_children)
-                { // find this node among siblings
-                    if (sibling == shared_from_this())
-                    {
-                        sibling = child_p; // replace this node by child
-                        break;
+            child_idx = node.children.front(); //recursive call to straighten might have removed the child
+            Node &child = m_nodes[child_idx];
+            if (node.parent != NoNode) {
+                Node &parent_node = m_nodes[node.parent];
+                if ((child.p - parent_node.p).cast<int64_t>().squaredNorm() < max_remove_colinear_dist2 &&
+                    Line::distance_to_squared(node.p, parent_node.p, child.p) < close_enough * close_enough) {
+                    child.parent = node.parent;
+                    for (NodeIdx& sibling : parent_node.children)
+                    { // find this node among siblings
+                        if (sibling == idx)
+                        {
+                            sibling = child_idx; // replace this node by child
+                            break;
+                        }
                     }
                 }
             }
@@ -283,62 +298,65 @@ Node::RectilinearJunction Node::straighten(
     else
     {
         constexpr coord_t weight = 1000;
-        Point junction_moving_dir = ((junction_above - m_p).cast<double>().normalized() * weight).cast<coord_t>();
+        Point junction_moving_dir = ((junction_above - node.p).cast<double>().normalized() * weight).cast<coord_t>();
         bool prevent_junction_moving = false;
-        for (auto& child_p : m_children)
+        // The recursive calls may replace the children of this node by their only child.
+        for (size_t i = 0; i < node.children.size(); ++ i)
         {
-            const auto child_dist = coord_t((m_p - child_p->m_p).cast<double>().norm());
-            RectilinearJunction below = child_p->straighten(magnitude, m_p, child_dist, max_remove_colinear_dist2);
+            const NodeIdx child_idx = node.children[i];
+            const auto child_dist = coord_t((node.p - m_nodes[child_idx].p).cast<double>().norm());
+            RectilinearJunction below = straighten(child_idx, magnitude, node.p, child_dist, max_remove_colinear_dist2);
 
-            junction_moving_dir += ((below.junction_loc - m_p).cast<double>().normalized() * weight).cast<coord_t>();
+            junction_moving_dir += ((below.junction_loc - node.p).cast<double>().normalized() * weight).cast<coord_t>();
             if (below.total_recti_dist < magnitude) // TODO: make configurable?
             {
                 prevent_junction_moving = true; // prevent flipflopping in branches due to straightening and junctoin moving clashing
             }
         }
-        if (junction_moving_dir != Point(0, 0) && ! m_children.empty() && ! m_is_root && ! prevent_junction_moving)
+        if (junction_moving_dir != Point(0, 0) && ! node.children.empty() && ! node.is_root && ! prevent_junction_moving)
         {
             auto junction_moving_dir_len = coord_t(junction_moving_dir.norm());
             if (junction_moving_dir_len > junction_magnitude)
             {
                 junction_moving_dir = junction_moving_dir * junction_magnitude / junction_moving_dir_len;
             }
-            m_p += junction_moving_dir;
+            node.p += junction_moving_dir;
         }
-        return RectilinearJunction{ accumulated_dist, m_p };
+        return RectilinearJunction{ accumulated_dist, node.p };
     }
 }
 
 // Prune the tree from the extremeties (leaf-nodes) until the pruning distance is reached.
-coord_t Node::prune(const coord_t& pruning_distance)
+coord_t NodeArena::prune(const NodeIdx idx, const coord_t& pruning_distance)
 {
     if (pruning_distance <= 0)
         return 0;
 
+    Node &node = m_nodes[idx];
     coord_t max_distance_pruned = 0;
-    for (auto child_it = m_children.begin(); child_it != m_children.end(); ) {
-        auto& child = *child_it;
-        coord_t dist_pruned_child = child->prune(pruning_distance);
+    for (auto child_it = node.children.begin(); child_it != node.children.end(); ) {
+        Node &child = m_nodes[*child_it];
+        coord_t dist_pruned_child = prune(*child_it, pruning_distance);
         if (dist_pruned_child >= pruning_distance)
         { // pruning is finished for child; dont modify further
             max_distance_pruned = std::max(max_distance_pruned, dist_pruned_child);
             ++child_it;
         } else {
-            const Point a = getLocation();
-            const Point b = child->getLocation();
+            const Point a = node.p;
+            const Point b = child.p;
             const Point ba = a - b;
             const auto ab_len = coord_t(ba.cast<double>().norm());
             if (dist_pruned_child + ab_len <= pruning_distance) { 
                 // we're still in the process of pruning
-                assert(child->m_children.empty() && "when pruning away a node all it's children must already have been pruned away");
+                assert(child.children.empty() && "when pruning away a node all it's children must already have been pruned away");
                 max_distance_pruned = std::max(max_distance_pruned, dist_pruned_child + ab_len);
-                child_it = m_children.erase(child_it);
+                child_it = node.children.erase(child_it);
             } else {
                 // pruning stops in between this node and the child
                 const Point n = b + (ba.cast<double>().normalized() * (pruning_distance - dist_pruned_child)).cast<coord_t>();
                 assert(std::abs((n - b).cast<double>().norm() + dist_pruned_child - pruning_distance) < 10 && "total pruned distance must be equal to the pruning_distance");
                 max_distance_pruned = std::max(max_distance_pruned, pruning_distance);
-                child->setLocation(n);
+                child.p = n;
                 ++child_it;
             }
         }
@@ -347,36 +365,36 @@ coord_t Node::prune(const coord_t& pruning_distance)
     return max_distance_pruned;
 }
 
-void Node::convertToPolylines(Polylines &output, const coord_t line_overlap) const
+void NodeArena::convertToPolylines(const NodeIdx root, Polylines &output, const coord_t line_overlap) const
 {
     Polylines result;
     result.emplace_back();
-    convertToPolylines(0, result);
+    convertToPolylines(root, 0, result);
     removeJunctionOverlap(result, line_overlap);
     append(output, std::move(result));
 }
 
-void Node::convertToPolylines(size_t long_line_idx, Polylines &output) const
+void NodeArena::convertToPolylines(const NodeIdx idx, size_t long_line_idx, Polylines &output) const
 {
-    if (m_children.empty()) {
-        output[long_line_idx].points.push_back(m_p);
+    const Node &node = (*this)[idx];
+    if (node.children.empty()) {
+        output[long_line_idx].points.push_back(node.p);
         return;
     }
-    size_t first_child_idx = rand() % m_children.size();
-    m_children[first_child_idx]->convertToPolylines(long_line_idx, output);
-    output[long_line_idx].points.push_back(m_p);
+    size_t first_child_idx = rand() % node.children.size();
+    convertToPolylines(node.children[first_child_idx], long_line_idx, output);
+    output[long_line_idx].points.push_back(node.p);
 
-    for (size_t idx_offset = 1; idx_offset < m_children.size(); idx_offset++) {
-        size_t child_idx = (first_child_idx + idx_offset) % m_children.size();
-        const Node& child = *m_children[child_idx];
+    for (size_t idx_offset = 1; idx_offset < node.children.size(); idx_offset++) {
+        size_t child_idx = (first_child_idx + idx_offset) % node.children.size();
         output.emplace_back();
         size_t child_line_idx = output.size() - 1;
-        child.convertToPolylines(child_line_idx, output);
-        output[child_line_idx].points.emplace_back(m_p);
+        convertToPolylines(node.children[child_idx], child_line_idx, output);
+        output[child_line_idx].points.emplace_back(node.p);
     }
 }
 
-void Node::removeJunctionOverlap(Polylines &result_lines, const coord_t line_overlap) const
+void NodeArena::removeJunctionOverlap(Polylines &result_lines, const coord_t line_overlap)
 {
     const coord_t reduction    = line_overlap;
     size_t        res_line_idx = 0;
@@ -413,27 +431,20 @@ void Node::removeJunctionOverlap(Polylines &result_lines, const coord_t line_ove
 }
 
 #ifdef LIGHTNING_TREE_NODE_DEBUG_OUTPUT
-void export_to_svg(const NodeSPtr &root_node, SVG &svg)
+void export_to_svg(const NodeArena &nodes, const NodeIdx root_node, SVG &svg)
 {
-    for (const NodeSPtr &children : root_node->m_children) {
-        svg.draw(Line(root_node->getLocation(), children->getLocation()), "red");
-        export_to_svg(children, svg);
-    }
+    nodes.visitBranches(root_node, [&svg](const Point &a, const Point &b) { svg.draw(Line(a, b), "red"); });
 }
 
-void export_to_svg(const std::string &path, const Polygons &contour, const std::vector<NodeSPtr> &root_nodes) {
+void export_to_svg(const std::string &path, const Polygons &contour, const NodeArena &nodes, const std::vector<NodeIdx> &root_nodes) {
     BoundingBox bbox = get_extents(contour);
 
     bbox.offset(SCALED_EPSILON);
     SVG svg(path, bbox);
     svg.draw_outline(contour, "blue");
 
-    for (const NodeSPtr &root_node: root_nodes) {
-        for (const NodeSPtr &children: root_node->m_children) {
-            svg.draw(Line(root_node->getLocation(), children->getLocation()), "red");
-            export_to_svg(children, svg);
-        }
-    }
+    for (const NodeIdx root_node : root_nodes)
+        export_to_svg(nodes, root_node, svg);
 }
 #endif /* LIGHTNING_TREE_NODE_DEBUG_OUTPUT */
 
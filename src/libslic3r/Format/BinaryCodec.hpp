@@ -0,0 +1,95 @@
+#ifndef slic3r_Format_BinaryCodec_hpp_
+#define slic3r_Format_BinaryCodec_hpp_
+
+// Fixed width binary records in the native byte order, shared by the binary cache files (SliceCache, PresetIndex).
+// The file formats derive their encoders and decoders from these to add their own record types.
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <type_traits>
+
+#include <boost/format.hpp>
+
+#include "../Exception.hpp"
+
+namespace Slic3r {
+
+// Appends fixed width binary data to a buffer.
+class BinaryEncoder
+{
+public:
+    std::string data;
+
+    template<typename T> void pod(const T &value)
+    {
+        static_assert(std::is_trivially_copyable<T>::value, "Only trivially copyable types may be written as is");
+        data.append(reinterpret_cast<const char*>(&value), sizeof(T));
+    }
+    // Number of the items following. Ids and indices are written with pod<uint64_t>().
+    void count(size_t n) { this->pod(uint64_t(n)); }
+    void string(const std::string &s)
+    {
+        this->count(s.size());
+        data.append(s);
+    }
+};
+
+// Reads fixed width binary data from a memory range, checking its bounds.
+// Throws Slic3r::FileIOError if a record is shorter than expected.
+class BinaryDecoder
+{
+public:
+    // file_type names the kind of file in the error messages, for example "Slice cache".
+    BinaryDecoder(const char *begin, const char *end, const char *file_type, const std::string &path) :
+        m_ptr(begin), m_end(end), m_file_type(file_type), m_path(path) {}
+
+    bool at_end() const { return m_ptr == m_end; }
+
+    template<typename T> T pod()
+    {
+        static_assert(std::is_trivially_copyable<T>::value, "Only trivially copyable types may be read as is");
+        T out;
+        ::memcpy(&out, this->take(sizeof(T)), sizeof(T));
+        return out;
+    }
+    // Number of the items following. Ids and indices are read with pod<uint64_t>(), as they are not bounded by the record size.
+    size_t count()
+    {
+        uint64_t n = this->pod<uint64_t>();
+        if (n > uint64_t(m_end - m_ptr))
+            // Any counted item takes at least a single byte, the file must be corrupted.
+            this->throw_corrupted();
+        return size_t(n);
+    }
+    std::string string()
+    {
+        size_t n = this->count();
+        return std::string(this->take(n), n);
+    }
+
+    [[noreturn]] void throw_corrupted() const
+    {
+        throw Slic3r::FileIOError((boost::format("%1% %2% is corrupted") % m_file_type % m_path).str());
+    }
+
+protected:
+    const char* take(size_t size)
+    {
+        if (size > size_t(m_end - m_ptr))
+            this->throw_corrupted();
+        const char *out = m_ptr;
+        m_ptr += size;
+        return out;
+    }
+
+private:
+    const char          *m_ptr;
+    const char          *m_end;
+    const char          *m_file_type;
+    const std::string   &m_path;
+};
+
+} // namespace Slic3r
+
+#endif /* slic3r_Format_BinaryCodec_hpp_ */
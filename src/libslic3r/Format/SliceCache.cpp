@@ -0,0 +1,556 @@
+#include "SliceCache.hpp"
+#include "BinaryCodec.hpp"
+
+#include "../Exception.hpp"
+#include "../ExtrusionEntity.hpp"
+#include "../ExtrusionEntityCollection.hpp"
+#include "../Layer.hpp"
+#include "../Model.hpp"
+#include "../Print.hpp"
+
+#include <cstring>
+#include <type_traits>
+
+#include <boost/format.hpp>
+#include <boost/functional/hash.hpp>
+#include <boost/log/trivial.hpp>
+#include <boost/nowide/fstream.hpp>
+
+#include <tbb/parallel_for.h>
+
+namespace Slic3r {
+namespace SliceCache {
+
+static constexpr const char     MAGIC[8]        = { 'O', 'R', 'C', 'A', 'S', 'L', 'C', 'D' };
+// Written in the native byte order, used to reject caches written on a machine with a different byte order.
+static constexpr const uint32_t BYTE_ORDER_MARK = 0x01020304;
+
+// Fixed size part of the file, followed by the object name and the offset table.
+struct FileHeader
+{
+    char        magic[8];
+    uint32_t    version;
+    uint32_t    byte_order_mark;
+    uint32_t    coord_size;
+    uint32_t    reserved;
+    uint64_t    object_hash;
+    uint64_t    identify_id;
+    uint64_t    num_layers;
+    uint64_t    num_support_layers;
+    uint64_t    name_length;
+};
+static_assert(std::is_trivially_copyable<FileHeader>::value, "FileHeader is written as is");
+static_assert(sizeof(Point) == 2 * sizeof(coord_t), "Points are written as arrays of coord_t pairs");
+
+enum class EntityType : uint8_t {
+    Path,
+    MultiPath,
+    Loop,
+    Collection
+};
+
+template<typename T>
+static inline void hash_range(size_t &seed, const T *begin, const T *end)
+{
+    for (; begin != end; ++ begin)
+        boost::hash_combine(seed, *begin);
+}
+
+uint64_t object_hash(const PrintObject &object)
+{
+    size_t seed = object.config().hash();
+    const Transform3d &trafo = object.trafo();
+    hash_range(seed, trafo.data(), trafo.data() + 16);
+
+    const ModelObject &model_object = *object.model_object();
+    for (const ModelVolume *volume : model_object.volumes) {
+        boost::hash_combine(seed, int(volume->type()));
+        const Transform3d &matrix = volume->get_matrix();
+        hash_range(seed, matrix.data(), matrix.data() + 16);
+        const indexed_triangle_set &its = volume->mesh().its;
+        boost::hash_combine(seed, its.vertices.size());
+        for (const stl_vertex &v : its.vertices)
+            hash_range(seed, v.data(), v.data() + 3);
+        boost::hash_combine(seed, its.indices.size());
+        for (const stl_triangle_vertex_indices &f : its.indices)
+            hash_range(seed, f.data(), f.data() + 3);
+        for (const FacetsAnnotation *facets : { &volume->supported_facets, &volume->seam_facets, &volume->mmu_segmentation_facets }) {
+            const auto &data = facets->get_data();
+            for (const std::pair<int, int> &item : data.first) {
+                boost::hash_combine(seed, item.first);
+                boost::hash_combine(seed, item.second);
+            }
+            boost::hash_combine(seed, data.second);
+        }
+    }
+    const std::vector<coordf_t> layer_height_profile = model_object.layer_height_profile.get();
+    hash_range(seed, layer_height_profile.data(), layer_height_profile.data() + layer_height_profile.size());
+    return uint64_t(seed);
+}
+
+// Appends the layer records to a buffer.
+class Encoder : public BinaryEncoder
+{
+public:
+    void points(const Points &pts)
+    {
+        this->count(pts.size());
+        data.append(reinterpret_cast<const char*>(pts.data()), pts.size() * sizeof(Point));
+    }
+    void point(const Point &pt) { this->pod(pt.x()); this->pod(pt.y()); }
+    void bbox(const BoundingBox &bbox)
+    {
+        this->point(bbox.min);
+        this->point(bbox.max);
+        this->pod(uint8_t(bbox.defined));
+    }
+    void expolygon(const ExPolygon &expoly)
+    {
+        this->points(expoly.contour.points);
+        this->count(expoly.holes.size());
+        for (const Polygon &hole : expoly.holes)
+            this->points(hole.points);
+    }
+    void expolygons(const ExPolygons &expolys)
+    {
+        this->count(expolys.size());
+        for (const ExPolygon &expoly : expolys)
+            this->expolygon(expoly);
+    }
+    void surfaces(const Surfaces &surfaces)
+    {
+        this->count(surfaces.size());
+        for (const Surface &surface : surfaces) {
+            this->pod(int32_t(surface.surface_type));
+            this->expolygon(surface.expolygon);
+            this->pod(surface.thickness);
+            this->pod(surface.thickness_layers);
+            this->pod(surface.bridge_angle);
+            this->pod(surface.extra_perimeters);
+        }
+    }
+    void polyline(const Polyline &polyline)
+    {
+        this->points(polyline.points);
+        this->count(polyline.fitting_result.size());
+        for (const PathFittingData &fitting : polyline.fitting_result) {
+            this->pod(uint64_t(fitting.start_point_index));
+            this->pod(uint64_t(fitting.end_point_index));
+            this->pod(int32_t(fitting.path_type));
+            const ArcSegment &arc = fitting.arc_data;
+            this->pod(uint8_t(arc.is_arc));
+            if (arc.is_arc) {
+                this->pod(arc.length);
+                this->pod(arc.angle_radians);
+                this->pod(arc.polar_start_theta);
+                this->pod(arc.polar_end_theta);
+                this->point(arc.start_point);
+                this->point(arc.end_point);
+                this->pod(int32_t(arc.direction));
+                this->pod(arc.radius);
+                this->point(arc.center);
+            }
+        }
+    }
+    void path(const ExtrusionPath &path)
+    {
+        this->polyline(path.polyline);
+        this->pod(int32_t(path.overhang_degree));
+        this->pod(int32_t(path.curve_degree));
+        this->pod(path.mm3_per_mm);
+        this->pod(path.width);
+        this->pod(path.height);
+        this->pod(int32_t(path.role()));
+        this->pod(uint8_t(path.is_force_no_extrusion()));
+    }
+    void paths(const ExtrusionPaths &paths)
+    {
+        this->count(paths.size());
+        for (const ExtrusionPath &path : paths)
+            this->path(path);
+    }
+    // Content of a collection without the type tag.
+    void collection(const ExtrusionEntityCollection &collection)
+    {
+        this->pod(uint8_t(collection.no_sort));
+        this->count(collection.entities.size());
+        for (const ExtrusionEntity *entity : collection.entities)
+            this->entity(*entity);
+    }
+    void entity(const ExtrusionEntity &entity)
+    {
+        if (const auto *collection = dynamic_cast<const ExtrusionEntityCollection*>(&entity)) {
+            this->pod(EntityType::Collection);
+            this->collection(*collection);
+        } else if (const auto *path = dynamic_cast<const ExtrusionPath*>(&entity)) {
+            this->pod(EntityType::Path);
+            this->path(*path);
+        } else if (const auto *multipath = dynamic_cast<const ExtrusionMultiPath*>(&entity)) {
+            this->pod(EntityType::MultiPath);
+            this->paths(multipath->paths);
+        } else if (const auto *loop = dynamic_cast<const ExtrusionLoop*>(&entity)) {
+            this->pod(EntityType::Loop);
+            this->pod(int32_t(loop->loop_role()));
+            this->paths(loop->paths);
+        } else
+            throw Slic3r::FileIOError("Slice cache: unknown type of an extrusion entity");
+    }
+    void layer_header(const Layer &layer, size_t interface_id)
+    {
+        this->pod(uint64_t(layer.id()));
+        this->pod(uint64_t(interface_id));
+        this->pod(double(layer.height));
+        this->pod(double(layer.print_z));
+        this->pod(double(layer.slice_z));
+        this->count(layer.regions().size());
+        for (const LayerRegion *layerm : layer.regions())
+            this->pod(uint64_t(layerm->region().config_hash()));
+    }
+    void layer_content(const Layer &layer)
+    {
+        this->expolygons(layer.lslices);
+        this->count(layer.lslices_bboxes.size());
+        for (const BoundingBox &bbox : layer.lslices_bboxes)
+            this->bbox(bbox);
+        this->expolygons(layer.loverhangs);
+        this->bbox(layer.loverhangs_bbox);
+        for (const LayerRegion *layerm : layer.regions()) {
+            this->surfaces(layerm->slices.surfaces);
+            this->expolygons(layerm->raw_slices);
+            this->collection(layerm->thin_fills);
+            this->expolygons(layerm->fill_expolygons);
+            this->surfaces(layerm->fill_surfaces.surfaces);
+            this->expolygons(layerm->fill_no_overlap_expolygons);
+            this->count(layerm->unsupported_bridge_edges.size());
+            for (const Polyline &polyline : layerm->unsupported_bridge_edges)
+                this->polyline(polyline);
+            this->collection(layerm->perimeters);
+            this->collection(layerm->fills);
+        }
+    }
+};
+
+// Reads the layer records from a memory range, checking its bounds.
+class Decoder : public BinaryDecoder
+{
+public:
+    Decoder(const char *begin, const char *end, const std::string &path) : BinaryDecoder(begin, end, "Slice cache", path) {}
+
+    void points(Points &pts)
+    {
+        size_t n = this->count();
+        pts.resize(n);
+        ::memcpy(pts.data(), this->take(n * sizeof(Point)), n * sizeof(Point));
+    }
+    Point point()
+    {
+        coord_t x = this->pod<coord_t>();
+        coord_t y = this->pod<coord_t>();
+        return { x, y };
+    }
+    BoundingBox bbox()
+    {
+        BoundingBox out;
+        out.min     = this->point();
+        out.max     = this->point();
+        out.defined = this->pod<uint8_t>() != 0;
+        return out;
+    }
+    void expolygon(ExPolygon &expoly)
+    {
+        this->points(expoly.contour.points);
+        expoly.holes.resize(this->count());
+        for (Polygon &hole : expoly.holes)
+            this->points(hole.points);
+    }
+    void expolygons(ExPolygons &expolys)
+    {
+        expolys.resize(this->count());
+        for (ExPolygon &expoly : expolys)
+            this->expolygon(expoly);
+    }
+    void surfaces(Surfaces &surfaces)
+    {
+        size_t n = this->count();
+        surfaces.reserve(n);
+        for (size_t i = 0; i < n; ++ i) {
+            auto surface_type = SurfaceType(this->pod<int32_t>());
+            ExPolygon expoly;
+            this->expolygon(expoly);
+            Surface &surface = surfaces.emplace_back(surface_type, std::move(expoly));
+            surface.thickness        = this->pod<double>();
+            surface.thickness_layers = this->pod<unsigned short>();
+            surface.bridge_angle     = this->pod<double>();
+            surface.extra_perimeters = this->pod<unsigned short>();
+        }
+    }
+    void polyline(Polyline &polyline)
+    {
+        this->points(polyline.points);
+        polyline.fitting_result.resize(this->count());
+        for (PathFittingData &fitting : polyline.fitting_result) {
+            fitting.start_point_index = size_t(this->pod<uint64_t>());
+            fitting.end_point_index   = size_t(this->pod<uint64_t>());
+            fitting.path_type         = EMovePathType(this->pod<int32_t>());
+            ArcSegment &arc = fitting.arc_data;
+            arc.is_arc = this->pod<uint8_t>() != 0;
+            if (arc.is_arc) {
+                arc.length            = this->pod<double>();
+                arc.angle_radians     = this->pod<double>();
+                arc.polar_start_theta = this->pod<double>();
+                arc.polar_end_theta   = this->pod<double>();
+                arc.start_point       = this->point();
+                arc.end_point         = this->point();
+                arc.direction         = ArcDirection(this->pod<int32_t>());
+                arc.radius            = this->pod<double>();
+                arc.center            = this->point();
+            }
+        }
+    }
+    void path(ExtrusionPath &path)
+    {
+        this->polyline(path.polyline);
+        path.overhang_degree = this->pod<int32_t>();
+        path.curve_degree    = this->pod<int32_t>();
+        path.mm3_per_mm      = this->pod<double>();
+        path.width           = this->pod<float>();
+        path.height          = this->pod<float>();
+        path.set_extrusion_role(ExtrusionRole(this->pod<int32_t>()));
+        path.set_force_no_extrusion(this->pod<uint8_t>() != 0);
+    }
+    void paths(ExtrusionPaths &paths)
+    {
+        paths.resize(this->count());
+        for (ExtrusionPath &path : paths)
+            this->path(path);
+    }
+    void collection(ExtrusionEntityCollection &collection)
+    {
+        collection.no_sort = this->pod<uint8_t>() != 0;
+        size_t n = this->count();
+        collection.entities.reserve(collection.entities.size() + n);
+        for (size_t i = 0; i < n; ++ i)
+            collection.entities.emplace_back(this->entity());
+    }
+    ExtrusionEntity* entity()
+    {
+        switch (this->pod<EntityType>()) {
+        case EntityType::Collection: {
+            auto *collection = new ExtrusionEntityCollection();
+            std::unique_ptr<ExtrusionEntity> guard(collection);
+            this->collection(*collection);
+            return guard.release();
+        }
+        case EntityType::Path: {
+            auto path = std::make_unique<ExtrusionPath>();
+            this->path(*path);
+            return path.release();
+        }
+        case EntityType::MultiPath: {
+            auto multipath = std::make_unique<ExtrusionMultiPath>();
+            this->paths(multipath->paths);
+            return multipath.release();
+        }
+        case EntityType::Loop: {
+            auto loop = std::make_unique<ExtrusionLoop>();
+            loop->set_loop_role(ExtrusionLoopRole(this->pod<int32_t>()));
+            this->paths(loop->paths);
+            return loop.release();
+        }
+        default:
+            this->throw_corrupted();
+        }
+        return nullptr;
+    }
+    LayerHeader layer_header()
+    {
+        LayerHeader out;
+        out.id           = size_t(this->pod<uint64_t>());
+        out.interface_id = size_t(this->pod<uint64_t>());
+        out.height       = this->pod<double>();
+        out.print_z      = this->pod<double>();
+        out.slice_z      = this->pod<double>();
+        out.region_config_hashes.resize(this->count());
+        for (uint64_t &hash : out.region_config_hashes)
+            hash = this->pod<uint64_t>();
+        return out;
+    }
+    void layer_content(Layer &layer)
+    {
+        this->expolygons(layer.lslices);
+        layer.lslices_bboxes.resize(this->count());
+        for (BoundingBox &bbox : layer.lslices_bboxes)
+            bbox = this->bbox();
+        this->expolygons(layer.loverhangs);
+        layer.loverhangs_bbox = this->bbox();
+        for (LayerRegion *layerm : layer.regions()) {
+            this->surfaces(layerm->slices.surfaces);
+            this->expolygons(layerm->raw_slices);
+            this->collection(layerm->thin_fills);
+            this->expolygons(layerm->fill_expolygons);
+            this->surfaces(layerm->fill_surfaces.surfaces);
+            this->expolygons(layerm->fill_no_overlap_expolygons);
+            layerm->unsupported_bridge_edges.resize(this->count());
+            for (Polyline &polyline : layerm->unsupported_bridge_edges)
+                this->polyline(polyline);
+            this->collection(layerm->perimeters);
+            this->collection(layerm->fills);
+        }
+    }
+};
+
+void save(const std::string &path, const PrintObject &object, const std::string &name, uint64_t identify_id, const FirstLayerGroups &first_layer_groups)
+{
+    const size_t num_layers         = object.layer_count();
+    const size_t num_support_layers = object.support_layer_count();
+
+    // Encode the layer records in parallel.
+    std::vector<std::string> records(num_layers + num_support_layers + 1);
+    tbb::parallel_for(tbb::blocked_range<size_t>(0, num_layers + num_support_layers),
+        [&object, &records, num_layers](const tbb::blocked_range<size_t> &range) {
+            for (size_t i = range.begin(); i < range.end(); ++ i) {
+                Encoder encoder;
+                if (i < num_layers) {
+                    const Layer &layer = *object.get_layer(int(i));
+                    encoder.layer_header(layer, 0);
+                    encoder.layer_content(layer);
+                } else {
+                    const SupportLayer &layer = *object.support_layers()[i - num_layers];
+                    encoder.layer_header(layer, layer.interface_id());
+                    encoder.layer_content(layer);
+                    encoder.pod(int32_t(layer.support_type));
+                    encoder.expolygons(layer.support_islands);
+                    encoder.collection(layer.support_fills);
+                }
+                records[i] = std::move(encoder.data);
+            }
+        });
+    {
+        Encoder encoder;
+        encoder.count(first_layer_groups.size());
+        for (const groupedVolumeSlices &group : first_layer_groups) {
+            encoder.pod(int32_t(group.groupId));
+            encoder.count(group.volume_ids.size());
+            for (const ObjectID &volume_idx : group.volume_ids)
+                encoder.pod(uint64_t(volume_idx.id));
+            encoder.expolygons(group.slices);
+        }
+        records.back() = std::move(encoder.data);
+    }
+
+    FileHeader header;
+    ::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    header.version            = FORMAT_VERSION;
+    header.byte_order_mark    = BYTE_ORDER_MARK;
+    header.coord_size         = uint32_t(sizeof(coord_t));
+    header.reserved           = 0;
+    header.object_hash        = object_hash(object);
+    header.identify_id        = identify_id;
+    header.num_layers         = num_layers;
+    header.num_support_layers = num_support_layers;
+    header.name_length        = name.size();
+
+    // Offsets of all the records plus the end of file.
+    std::vector<uint64_t> offsets(records.size() + 1);
+    offsets.front() = sizeof(FileHeader) + name.size() + offsets.size() * sizeof(uint64_t);
+    for (size_t i = 0; i < records.size(); ++ i)
+        offsets[i + 1] = offsets[i] + records[i].size();
+
+    boost::nowide::ofstream out(path, std::ios::out | std::ios::trunc | std::ios::binary);
+    if (! out)
+        throw Slic3r::FileIOError((boost::format("Cannot create slice cache %1%") % path).str());
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    out.write(name.data(), name.size());
+    out.write(reinterpret_cast<const char*>(offsets.data()), offsets.size() * sizeof(uint64_t));
+    for (const std::string &record : records)
+        out.write(record.data(), record.size());
+    out.close();
+    if (! out)
+        throw Slic3r::FileIOError((boost::format("Failed writing slice cache %1%") % path).str());
+}
+
+Reader::Reader(const std::string &path) : m_path(path)
+{
+    try {
+        m_file.open(path);
+    } catch (const std::exception &ex) {
+        throw Slic3r::FileIOError((boost::format("Cannot open slice cache %1%: %2%") % path % ex.what()).str());
+    }
+
+    Decoder decoder(m_file.data(), m_file.data() + m_file.size(), m_path);
+    const FileHeader header = decoder.pod<FileHeader>();
+    if (::memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0 || header.byte_order_mark != BYTE_ORDER_MARK)
+        throw Slic3r::FileIOError((boost::format("%1% is not a slice cache") % path).str());
+    if (header.version != FORMAT_VERSION || header.coord_size != sizeof(coord_t))
+        throw Slic3r::FileIOError((boost::format("Slice cache %1% has an incompatible version %2%") % path % header.version).str());
+    if (header.name_length > m_file.size() || header.num_layers + header.num_support_layers > m_file.size())
+        decoder.throw_corrupted();
+
+    m_object_hash = header.object_hash;
+    m_identify_id = header.identify_id;
+    m_name.resize(size_t(header.name_length));
+    for (char &c : m_name)
+        c = decoder.pod<char>();
+
+    m_offsets.resize(size_t(header.num_layers + header.num_support_layers) + 2);
+    for (uint64_t &offset : m_offsets)
+        offset = decoder.pod<uint64_t>();
+    for (size_t i = 1; i < m_offsets.size(); ++ i)
+        if (m_offsets[i] < m_offsets[i - 1])
+            decoder.throw_corrupted();
+    if (m_offsets.back() != m_file.size())
+        decoder.throw_corrupted();
+
+    // Layer headers are short, decode them all so that the layers could be created before their content is loaded.
+    auto read_headers = [this](size_t first, size_t num, std::vector<LayerHeader> &headers) {
+        headers.reserve(num);
+        for (size_t i = first; i < first + num; ++ i)
+            headers.emplace_back(Decoder(m_file.data() + m_offsets[i], m_file.data() + m_offsets[i + 1], m_path).layer_header());
+    };
+    read_headers(0, size_t(header.num_layers), m_layers);
+    read_headers(size_t(header.num_layers), size_t(header.num_support_layers), m_support_layers);
+}
+
+void Reader::load_layer(size_t idx, Layer &layer) const
+{
+    assert(idx < m_layers.size());
+    Decoder decoder(m_file.data() + m_offsets[idx], m_file.data() + m_offsets[idx + 1], m_path);
+    decoder.layer_header();
+    decoder.layer_content(layer);
+    if (! decoder.at_end())
+        decoder.throw_corrupted();
+}
+
+void Reader::load_support_layer(size_t idx, SupportLayer &layer) const
+{
+    assert(idx < m_support_layers.size());
+    idx += m_layers.size();
+    Decoder decoder(m_file.data() + m_offsets[idx], m_file.data() + m_offsets[idx + 1], m_path);
+    decoder.layer_header();
+    decoder.layer_content(layer);
+    layer.support_type = SupportInnerType(decoder.pod<int32_t>());
+    decoder.expolygons(layer.support_islands);
+    decoder.collection(layer.support_fills);
+    if (! decoder.at_end())
+        decoder.throw_corrupted();
+}
+
+FirstLayerGroups Reader::load_first_layer_groups() const
+{
+    size_t   idx = m_offsets.size() - 2;
+    Decoder  decoder(m_file.data() + m_offsets[idx], m_file.data() + m_offsets[idx + 1], m_path);
+    FirstLayerGroups out(decoder.count());
+    for (groupedVolumeSlices &group : out) {
+        group.groupId = decoder.pod<int32_t>();
+        group.volume_ids.resize(decoder.count());
+        for (ObjectID &volume_idx : group.volume_ids)
+            volume_idx.id = size_t(decoder.pod<uint64_t>());
+        decoder.expolygons(group.slices);
+    }
+    if (! decoder.at_end())
+        decoder.throw_corrupted();
+    return out;
+}
+
+} // namespace SliceCache
+} // namespace Slic3r
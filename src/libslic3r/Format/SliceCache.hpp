@@ -0,0 +1,90 @@
+#ifndef slic3r_Format_SliceCache_hpp_
+#define slic3r_Format_SliceCache_hpp_
+
+// Binary cache of the sliced layers of a PrintObject, used by the command line slicer
+// to export the slicing results and to load them in a later run (--export-slicedata / --load-slicedata).
+//
+// The file consists of a fixed size header, the name of the object, a table of offsets of the layer records
+// and the layer records themselves. Each record stores the polygons as fixed width point arrays,
+// therefore the records may be decoded lazily or in parallel straight from a memory mapped file.
+// The header stores a hash of the inputs the layers were generated from, so that a stale cache is rejected.
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <boost/iostreams/device/mapped_file.hpp>
+
+namespace Slic3r {
+
+class Layer;
+class SupportLayer;
+class PrintObject;
+struct groupedVolumeSlices;
+
+namespace SliceCache {
+
+// Increase whenever the layout of the file changes.
+static constexpr const uint32_t FORMAT_VERSION = 1;
+
+// Hash of the inputs, which the layers of a PrintObject were generated from: The object configuration,
+// the transformation, the meshes, transformations and paint-on data of the model volumes and the layer height profile.
+// Configurations of the regions are not part of the hash, they are matched one by one when loading the layers.
+uint64_t object_hash(const PrintObject &object);
+
+// Slices of a first layer group with the volumes referenced by their index into ModelObject::volumes.
+using FirstLayerGroups = std::vector<groupedVolumeSlices>;
+
+// Serialize all layers and support layers of a PrintObject. The layers are encoded in parallel.
+// Throws Slic3r::FileIOError on failure.
+void save(const std::string &path, const PrintObject &object, const std::string &name, uint64_t identify_id, const FirstLayerGroups &first_layer_groups);
+
+// Parameters of a layer needed to create it, before its content is loaded.
+struct LayerHeader
+{
+    size_t                  id           { 0 };
+    // Only valid for support layers.
+    size_t                  interface_id { 0 };
+    double                  height       { 0. };
+    double                  print_z      { 0. };
+    double                  slice_z      { 0. };
+    // PrintRegion::config_hash() of the layer regions in the order of Layer::regions().
+    std::vector<uint64_t>   region_config_hashes;
+};
+
+class Reader
+{
+public:
+    // Map the file into memory and validate its header and the offset table.
+    // Throws Slic3r::FileIOError if the file cannot be opened or if it is not a valid cache of the current format version.
+    explicit Reader(const std::string &path);
+
+    const std::string&              path()          const { return m_path; }
+    uint64_t                        object_hash()   const { return m_object_hash; }
+    uint64_t                        identify_id()   const { return m_identify_id; }
+    const std::string&              name()          const { return m_name; }
+    const std::vector<LayerHeader>& layers()        const { return m_layers; }
+    const std::vector<LayerHeader>& support_layers() const { return m_support_layers; }
+
+    // Decode the content of a layer, which has been created with the parameters of layers()[idx].
+    // The records are independent, thus the layers may be loaded in parallel.
+    void                            load_layer(size_t idx, Layer &layer) const;
+    void                            load_support_layer(size_t idx, SupportLayer &layer) const;
+    FirstLayerGroups                load_first_layer_groups() const;
+
+private:
+    std::string                             m_path;
+    boost::iostreams::mapped_file_source    m_file;
+    uint64_t                                m_object_hash { 0 };
+    uint64_t                                m_identify_id { 0 };
+    std::string                             m_name;
+    std::vector<LayerHeader>                m_layers;
+    std::vector<LayerHeader>                m_support_layers;
+    // Offsets of the layer records, support layer records, first layer groups record and the end of the file.
+    std::vector<uint64_t>                   m_offsets;
+};
+
+} // namespace SliceCache
+} // namespace Slic3r
+
+#endif /* slic3r_Format_SliceCache_hpp_ */
@@ -452,6 +452,58 @@ bool bbs_get_attribute_value_bool(const char** attributes, unsigned int attribut
     return (text != nullptr) ? (bool)::atoi(text) : true;
 }
 
+// Vertices and triangles are by far the most frequent elements of a model file, thus their attributes are scanned
+// in a single pass instead of looking up each attribute by its name. Missing values are set equal to ZERO.
+Slic3r::Vec3f bbs_get_vertex_attributes(const char** attributes, unsigned int attributes_size)
+{
+    Slic3r::Vec3f out = Slic3r::Vec3f::Zero();
+    if ((attributes == nullptr) || (attributes_size % 2 != 0))
+        return out;
+
+    for (unsigned int a = 0; a < attributes_size; a += 2) {
+        // X_ATTR, Y_ATTR, Z_ATTR
+        const char *key = attributes[a];
+        if (key[0] >= 'x' && key[0] <= 'z' && key[1] == 0) {
+            const char *text = attributes[a + 1];
+            fast_float::from_chars(text, text + strlen(text), out(key[0] - 'x'));
+        }
+    }
+    return out;
+}
+
+struct TriangleAttributes
+{
+    Slic3r::Vec3i   vertices        { Slic3r::Vec3i::Zero() };
+    const char     *custom_supports { "" };
+    const char     *custom_seam     { "" };
+    const char     *mmu_segmentation{ "" };
+    const char     *face_property   { "" };
+};
+
+TriangleAttributes bbs_get_triangle_attributes(const char** attributes, unsigned int attributes_size)
+{
+    TriangleAttributes out;
+    if ((attributes == nullptr) || (attributes_size % 2 != 0))
+        return out;
+
+    for (unsigned int a = 0; a < attributes_size; a += 2) {
+        const char *key  = attributes[a];
+        const char *text = attributes[a + 1];
+        if (key[0] == 'v' && key[1] >= '1' && key[1] <= '3' && key[2] == 0)
+            // V1_ATTR, V2_ATTR, V3_ATTR
+            boost::spirit::qi::parse(text, text + strlen(text), boost::spirit::qi::int_, out.vertices(key[1] - '1'));
+        else if (::strcmp(key, CUSTOM_SUPPORTS_ATTR) == 0)
+            out.custom_supports = text;
+        else if (::strcmp(key, CUSTOM_SEAM_ATTR) == 0)
+            out.custom_seam = text;
+        else if (::strcmp(key, MMU_SEGMENTATION_ATTR) == 0)
+            out.mmu_segmentation = text;
+        else if (::strcmp(key, FACE_PROPERTY_ATTR) == 0)
+            out.face_property = text;
+    }
+    return out;
+}
+
 void add_vec3(std::stringstream &stream, const Slic3r::Vec3f &tr)
 {
     for (unsigned r = 0; r < 3; ++r) {
@@ -3469,10 +3521,7 @@ void PlateData::parse_filament_info(GCodeProcessorResult *result)
         // appends the vertex coordinates
         // missing values are set equal to ZERO
         if (m_curr_object)
-            m_curr_object->geometry.vertices.emplace_back(
-                m_unit_factor * bbs_get_attribute_value_float(attributes, num_attributes, X_ATTR),
-                m_unit_factor * bbs_get_attribute_value_float(attributes, num_attributes, Y_ATTR),
-                m_unit_factor * bbs_get_attribute_value_float(attributes, num_attributes, Z_ATTR));
+            m_curr_object->geometry.vertices.emplace_back(m_unit_factor * bbs_get_vertex_attributes(attributes, num_attributes));
         return true;
     }
 
@@ -3508,16 +3557,13 @@ void PlateData::parse_filament_info(GCodeProcessorResult *result)
         // appends the triangle's vertices indices
         // missing values are set equal to ZERO
         if (m_curr_object) {
-            m_curr_object->geometry.triangles.emplace_back(
-                bbs_get_attribute_value_int(attributes, num_attributes, V1_ATTR),
-                bbs_get_attribute_value_int(attributes, num_attributes, V2_ATTR),
-                bbs_get_attribute_value_int(attributes, num_attributes, V3_ATTR));
-
-            m_curr_object->geometry.custom_supports.push_back(bbs_get_attribute_value_string(attributes, num_attributes, CUSTOM_SUPPORTS_ATTR));
-            m_curr_object->geometry.custom_seam.push_back(bbs_get_attribute_value_string(attributes, num_attributes, CUSTOM_SEAM_ATTR));
-            m_curr_object->geometry.mmu_segmentation.push_back(bbs_get_attribute_value_string(attributes, num_attributes, MMU_SEGMENTATION_ATTR));
+            const TriangleAttributes triangle = bbs_get_triangle_attributes(attributes, num_attributes);
+            m_curr_object->geometry.triangles.emplace_back(triangle.vertices);
+            m_curr_object->geometry.custom_supports.emplace_back(triangle.custom_supports);
+            m_curr_object->geometry.custom_seam.emplace_back(triangle.custom_seam);
+            m_curr_object->geometry.mmu_segmentation.emplace_back(triangle.mmu_segmentation);
             // BBS
-            m_curr_object->geometry.face_properties.push_back(bbs_get_attribute_value_string(attributes, num_attributes, FACE_PROPERTY_ATTR));
+            m_curr_object->geometry.face_properties.emplace_back(triangle.face_property);
         }
         return true;
     }
@@ -5076,10 +5122,7 @@ void PlateData::parse_filament_info(GCodeProcessorResult *result)
         // appends the vertex coordinates
         // missing values are set equal to ZERO
         if (current_object)
-            current_object->geometry.vertices.emplace_back(
-                object_unit_factor * bbs_get_attribute_value_float(attributes, num_attributes, X_ATTR),
-                object_unit_factor * bbs_get_attribute_value_float(attributes, num_attributes, Y_ATTR),
-                object_unit_factor * bbs_get_attribute_value_float(attributes, num_attributes, Z_ATTR));
+            current_object->geometry.vertices.emplace_back(object_unit_factor * bbs_get_vertex_attributes(attributes, num_attributes));
         return true;
     }
 
@@ -5115,16 +5158,13 @@ void PlateData::parse_filament_info(GCodeProcessorResult *result)
         // appends the triangle's vertices indices
         // missing values are set equal to ZERO
         if (current_object) {
-            current_object->geometry.triangles.emplace_back(
-                bbs_get_attribute_value_int(attributes, num_attributes, V1_ATTR),
-                bbs_get_attribute_value_int(attributes, num_attributes, V2_ATTR),
-                bbs_get_attribute_value_int(attributes, num_attributes, V3_ATTR));
-
-            current_object->geometry.custom_supports.push_back(bbs_get_attribute_value_string(attributes, num_attributes, CUSTOM_SUPPORTS_ATTR));
-            current_object->geometry.custom_seam.push_back(bbs_get_attribute_value_string(attributes, num_attributes, CUSTOM_SEAM_ATTR));
-            current_object->geometry.mmu_segmentation.push_back(bbs_get_attribute_value_string(attributes, num_attributes, MMU_SEGMENTATION_ATTR));
+            const TriangleAttributes triangle = bbs_get_triangle_attributes(attributes, num_attributes);
+            current_object->geometry.triangles.emplace_back(triangle.vertices);
+            current_object->geometry.custom_supports.emplace_back(triangle.custom_supports);
+            current_object->geometry.custom_seam.emplace_back(triangle.custom_seam);
+            current_object->geometry.mmu_segmentation.emplace_back(triangle.mmu_segmentation);
             // BBS
-            current_object->geometry.face_properties.push_back(bbs_get_attribute_value_string(attributes, num_attributes, FACE_PROPERTY_ATTR));
+            current_object->geometry.face_properties.emplace_back(triangle.face_property);
         }
         return true;
     }
@@ -18,6 +18,7 @@
 #include "libslic3r.h"
 #include "LocalesUtils.hpp"
 #include "libslic3r/format.hpp"
+#include "Thread.hpp"
 #include "Time.hpp"
 #include "GCode/ExtrusionProcessor.hpp"
 #include <algorithm>
@@ -1504,7 +1505,8 @@ void GCode::do_export(Print* print, const char* path, GCodeProcessorResult* resu
     path_tmp += ".tmp";
 
     m_processor.initialize(path_tmp);
-    GCodeOutputStream file(boost::nowide::fopen(path_tmp.c_str(), "wb"), m_processor);
+    // Write and analyze the G-code from background threads, so that neither a slow disk nor the time estimation stalls the G-code generation.
+    GCodeOutputStream file(boost::nowide::fopen(path_tmp.c_str(), "wb"), m_processor, GCodeOutputStream::DEFAULT_BUFFER_SIZE, true);
     if (! file.is_open()) {
         BOOST_LOG_TRIVIAL(error) << std::string("G-code export to ") + path + " failed.\nCannot open the file for writing.\n" << std::endl;
         if (!fs::exists(folder)) {
@@ -2691,8 +2693,39 @@ void GCode::check_placeholder_parser_failed()
     }
 }
 
+// Does any region of the print slow down over overhangs using the ExtrusionQualityEstimator?
+static bool print_uses_extrusion_quality_estimator(const Print &print)
+{
+    for (size_t region_id = 0; region_id < print.num_print_regions(); ++ region_id) {
+        const PrintRegionConfig &config = print.get_print_region(region_id).config();
+        if (config.enable_overhang_speed && ! config.overhang_speed_classic)
+            return true;
+    }
+    return false;
+}
+
+static std::vector<ExtrusionQualityEstimator::LayerBoundaries> precalculate_quality_estimator_boundaries(const std::vector<GCode::LayerToPrint> &layers)
+{
+    std::vector<ExtrusionQualityEstimator::LayerBoundaries> out;
+    out.reserve(layers.size());
+    for (const GCode::LayerToPrint &layer_to_print : layers)
+        out.emplace_back(layer_to_print.object_layer ?
+            ExtrusionQualityEstimator::LayerBoundaries(*layer_to_print.object_layer) : ExtrusionQualityEstimator::LayerBoundaries());
+    return out;
+}
+
+static std::vector<AvoidCrossingPerimeters::LayerDataPtr> precalculate_avoid_crossing_perimeters(const std::vector<GCode::LayerToPrint> &layers)
+{
+    std::vector<AvoidCrossingPerimeters::LayerDataPtr> out;
+    out.reserve(layers.size());
+    for (const GCode::LayerToPrint &layer_to_print : layers)
+        out.emplace_back(layer_to_print.layer() ? AvoidCrossingPerimeters::precalculate_layer(*layer_to_print.layer(), layer_to_print.support_layer) : nullptr);
+    return out;
+}
+
 // Process all layers of all objects (non-sequential mode) with a parallel pipeline:
-// Generate G-code, run the filters (vase mode, cooling buffer), run the G-code analyser
+// Precalculate the layer data independent of the G-code generator state in parallel,
+// generate G-code, run the filters (vase mode, cooling buffer), run the G-code analyser
 // and export G-code into file.
 void GCode::process_layers(
     const Print                                                         &print,
@@ -2702,29 +2735,45 @@ void GCode::process_layers(
     GCodeOutputStream                                                   &output_stream)
 {
     // The pipeline is variable: The vase mode filter is optional.
-    size_t layer_to_print_idx = 0;
-    const auto generator = tbb::make_filter<void, LayerResult>(slic3r_tbb_filtermode::serial_in_order,
-        [this, &print, &tool_ordering, &print_object_instances_ordering, &layers_to_print, &layer_to_print_idx](tbb::flow_control& fc) -> LayerResult {
-            if (layer_to_print_idx >= layers_to_print.size()) {
-            	if ((!m_pressure_equalizer && layer_to_print_idx == layers_to_print.size()) || (m_pressure_equalizer && layer_to_print_idx == (layers_to_print.size() + 1))) {
-                    fc.stop();
-                    return {};
-                } else {
-                    // Pressure equalizer need insert empty input. Because it returns one layer back.
-                    // Insert NOP (no operation) layer;
-                    ++layer_to_print_idx;
-                    return LayerResult::make_nop_layer_result();
-                }
+    size_t       layer_to_print_idx = 0;
+    // Pressure equalizer need insert empty input. Because it returns one layer back.
+    const size_t num_layers_to_emit = layers_to_print.size() + (m_pressure_equalizer ? 1 : 0);
+    const bool   prepare_quality_estimator = print_uses_extrusion_quality_estimator(print);
+    const bool   prepare_avoid_crossing_perimeters = print.config().reduce_crossing_wall.value;
+    const auto sequencer = tbb::make_filter<void, LayerPrepared>(slic3r_tbb_filtermode::serial_in_order,
+        [&layer_to_print_idx, num_layers_to_emit](tbb::flow_control& fc) -> LayerPrepared {
+            if (layer_to_print_idx == num_layers_to_emit) {
+                fc.stop();
+                return {};
+            }
+            LayerPrepared out;
+            out.layer_to_print_idx = layer_to_print_idx ++;
+            return out;
+        });
+    const auto prepare = tbb::make_filter<LayerPrepared, LayerPrepared>(slic3r_tbb_filtermode::parallel,
+        [&layers_to_print, prepare_quality_estimator, prepare_avoid_crossing_perimeters](LayerPrepared in) -> LayerPrepared {
+            if (prepare_quality_estimator && in.layer_to_print_idx < layers_to_print.size())
+                in.quality_estimator_boundaries = precalculate_quality_estimator_boundaries(layers_to_print[in.layer_to_print_idx].second);
+            if (prepare_avoid_crossing_perimeters && in.layer_to_print_idx < layers_to_print.size())
+                in.avoid_crossing_perimeters = precalculate_avoid_crossing_perimeters(layers_to_print[in.layer_to_print_idx].second);
+            return in;
+        });
+    const auto generator = tbb::make_filter<LayerPrepared, LayerResult>(slic3r_tbb_filtermode::serial_in_order,
+        [this, &print, &tool_ordering, &print_object_instances_ordering, &layers_to_print](LayerPrepared in) -> LayerResult {
+            if (in.layer_to_print_idx >= layers_to_print.size()) {
+                // Insert NOP (no operation) layer for the pressure equalizer;
+                return LayerResult::make_nop_layer_result();
             } else {
-                const std::pair<coordf_t, std::vector<LayerToPrint>>& layer = layers_to_print[layer_to_print_idx++];
+                const std::pair<coordf_t, std::vector<LayerToPrint>>& layer = layers_to_print[in.layer_to_print_idx];
                 const LayerTools& layer_tools = tool_ordering.tools_for_layer(layer.first);
-                print.set_status(80, Slic3r::format(_(L("Generating G-code: layer %1%")), std::to_string(layer_to_print_idx)));
+                print.set_status(80, Slic3r::format(_(L("Generating G-code: layer %1%")), std::to_string(in.layer_to_print_idx + 1)));
                 if (m_wipe_tower && layer_tools.has_wipe_tower)
                     m_wipe_tower->next_layer();
                 //BBS
                 check_placeholder_parser_failed();
                 print.throw_if_canceled();
-                return this->process_layer(print, layer.second, layer_tools, &layer == &layers_to_print.back(), &print_object_instances_ordering, size_t(-1));
+                return this->process_layer(print, layer.second, layer_tools, &layer == &layers_to_print.back(), &print_object_instances_ordering, size_t(-1),
+                    false, &in.quality_estimator_boundaries, &in.avoid_crossing_perimeters);
             }
         });
    
@@ -2747,7 +2796,7 @@ void GCode::process_layers(
             return cooling_buffer.process_layer(std::move(in.gcode), in.layer_id, in.cooling_buffer_flush);
         });
     const auto output = tbb::make_filter<std::string, void>(slic3r_tbb_filtermode::serial_in_order,
-        [&output_stream](std::string s) { output_stream.write(s); }
+        [&output_stream](std::string s) { output_stream.write(std::move(s)); }
     );
 
     const auto fan_mover = tbb::make_filter<std::string, std::string>(slic3r_tbb_filtermode::serial_in_order,
@@ -2772,17 +2821,18 @@ void GCode::process_layers(
 
     // The pipeline elements are joined using const references, thus no copying is performed.
     if (m_spiral_vase && m_pressure_equalizer)
-        tbb::parallel_pipeline(12, generator & spiral_mode & pressure_equalizer & cooling & fan_mover & output);
+        tbb::parallel_pipeline(12, sequencer & prepare & generator & spiral_mode & pressure_equalizer & cooling & fan_mover & output);
     else if (m_spiral_vase)
-    	tbb::parallel_pipeline(12, generator & spiral_mode & cooling & fan_mover & output);
+    	tbb::parallel_pipeline(12, sequencer & prepare & generator & spiral_mode & cooling & fan_mover & output);
     else if	(m_pressure_equalizer)
-        tbb::parallel_pipeline(12, generator & pressure_equalizer & cooling & fan_mover & output);
+        tbb::parallel_pipeline(12, sequencer & prepare & generator & pressure_equalizer & cooling & fan_mover & output);
     else
-    	tbb::parallel_pipeline(12, generator & cooling & fan_mover & output);
+    	tbb::parallel_pipeline(12, sequencer & prepare & generator & cooling & fan_mover & output);
 }
 
 // Process all layers of a single object instance (sequential mode) with a parallel pipeline:
-// Generate G-code, run the filters (vase mode, cooling buffer), run the G-code analyser
+// Precalculate the layer data independent of the G-code generator state in parallel,
+// generate G-code, run the filters (vase mode, cooling buffer), run the G-code analyser
 // and export G-code into file.
 void GCode::process_layers(
     const Print                             &print,
@@ -2794,20 +2844,36 @@ void GCode::process_layers(
     const bool                               prime_extruder)
 {
     // The pipeline is variable: The vase mode filter is optional.
-    size_t layer_to_print_idx = 0;
-    const auto generator = tbb::make_filter<void, LayerResult>(slic3r_tbb_filtermode::serial_in_order,
-        [this, &print, &tool_ordering, &layers_to_print, &layer_to_print_idx, single_object_idx, prime_extruder](tbb::flow_control& fc) -> LayerResult {
+    size_t     layer_to_print_idx = 0;
+    const bool prepare_quality_estimator = print_uses_extrusion_quality_estimator(print);
+    const bool prepare_avoid_crossing_perimeters = print.config().reduce_crossing_wall.value;
+    const auto sequencer = tbb::make_filter<void, LayerPrepared>(slic3r_tbb_filtermode::serial_in_order,
+        [&layers_to_print, &layer_to_print_idx](tbb::flow_control& fc) -> LayerPrepared {
             if (layer_to_print_idx == layers_to_print.size()) {
                 fc.stop();
                 return {};
-            } else {
-                LayerToPrint &layer = layers_to_print[layer_to_print_idx ++];
-                print.set_status(80, Slic3r::format(_(L("Generating G-code: layer %1%")), std::to_string(layer_to_print_idx)));
-                //BBS
-                check_placeholder_parser_failed();
-                print.throw_if_canceled();
-                return this->process_layer(print, { std::move(layer) }, tool_ordering.tools_for_layer(layer.print_z()), &layer == &layers_to_print.back(), nullptr, single_object_idx, prime_extruder);
             }
+            LayerPrepared out;
+            out.layer_to_print_idx = layer_to_print_idx ++;
+            return out;
+        });
+    const auto prepare = tbb::make_filter<LayerPrepared, LayerPrepared>(slic3r_tbb_filtermode::parallel,
+        [&layers_to_print, prepare_quality_estimator, prepare_avoid_crossing_perimeters](LayerPrepared in) -> LayerPrepared {
+            if (prepare_quality_estimator)
+                in.quality_estimator_boundaries = precalculate_quality_estimator_boundaries({ layers_to_print[in.layer_to_print_idx] });
+            if (prepare_avoid_crossing_perimeters)
+                in.avoid_crossing_perimeters = precalculate_avoid_crossing_perimeters({ layers_to_print[in.layer_to_print_idx] });
+            return in;
+        });
+    const auto generator = tbb::make_filter<LayerPrepared, LayerResult>(slic3r_tbb_filtermode::serial_in_order,
+        [this, &print, &tool_ordering, &layers_to_print, single_object_idx, prime_extruder](LayerPrepared in) -> LayerResult {
+            const LayerToPrint &layer = layers_to_print[in.layer_to_print_idx];
+            print.set_status(80, Slic3r::format(_(L("Generating G-code: layer %1%")), std::to_string(in.layer_to_print_idx + 1)));
+            //BBS
+            check_placeholder_parser_failed();
+            print.throw_if_canceled();
+            return this->process_layer(print, { layer }, tool_ordering.tools_for_layer(layer.print_z()), &layer == &layers_to_print.back(), nullptr, single_object_idx, prime_extruder,
+                &in.quality_estimator_boundaries, &in.avoid_crossing_perimeters);
         });
     const auto spiral_mode = tbb::make_filter<LayerResult, LayerResult>(slic3r_tbb_filtermode::serial_in_order,
         [&spiral_mode = *this->m_spiral_vase.get()](LayerResult in)->LayerResult {
@@ -2819,7 +2885,7 @@ void GCode::process_layers(
             return cooling_buffer.process_layer(std::move(in.gcode), in.layer_id, in.cooling_buffer_flush);
         });
     const auto output = tbb::make_filter<std::string, void>(slic3r_tbb_filtermode::serial_in_order,
-        [&output_stream](std::string s) { output_stream.write(s); }
+        [&output_stream](std::string s) { output_stream.write(std::move(s)); }
     );
 
     const auto fan_mover = tbb::make_filter<std::string, std::string>(slic3r_tbb_filtermode::serial_in_order,
@@ -2842,9 +2908,9 @@ void GCode::process_layers(
 
     // The pipeline elements are joined using const references, thus no copying is performed.
     if (m_spiral_vase)
-        tbb::parallel_pipeline(12, generator & spiral_mode & cooling & fan_mover & output);
+        tbb::parallel_pipeline(12, sequencer & prepare & generator & spiral_mode & cooling & fan_mover & output);
     else
-        tbb::parallel_pipeline(12, generator & cooling & fan_mover & output);
+        tbb::parallel_pipeline(12, sequencer & prepare & generator & cooling & fan_mover & output);
 }
 
 std::string GCode::placeholder_parser_process(const std::string &name, const std::string &templ, unsigned int current_extruder_id, const DynamicConfig *config_override)
@@ -3359,7 +3425,9 @@ LayerResult GCode::process_layer(
     // Otherwise print a single copy of a single object.
     const size_t                     		 single_object_instance_idx,
     // BBS
-    const bool                               prime_extruder)
+    const bool                               prime_extruder,
+    std::vector<ExtrusionQualityEstimator::LayerBoundaries> *quality_estimator_boundaries,
+    const std::vector<AvoidCrossingPerimeters::LayerDataPtr> *avoid_crossing_perimeters)
 {
     assert(! layers.empty());
     // Either printing all copies of all objects, or just a single copy of a single object.
@@ -3627,9 +3695,15 @@ LayerResult GCode::process_layer(
     };
     
     if (m_config.enable_overhang_speed && !m_config.overhang_speed_classic) {
-        for (const auto &layer_to_print : layers) {
-            m_extrusion_quality_estimator.prepare_for_new_layer(layer_to_print.original_object,
-                                                                layer_to_print.object_layer);
+        const bool precalculated = quality_estimator_boundaries != nullptr && quality_estimator_boundaries->size() == layers.size();
+        for (size_t i = 0; i < layers.size(); ++ i) {
+            const LayerToPrint &layer_to_print = layers[i];
+            if (layer_to_print.object_layer == nullptr)
+                continue;
+            if (precalculated)
+                m_extrusion_quality_estimator.prepare_for_new_layer(layer_to_print.original_object, std::move((*quality_estimator_boundaries)[i]));
+            else
+                m_extrusion_quality_estimator.prepare_for_new_layer(layer_to_print.original_object, layer_to_print.object_layer);
         }
     }
 
@@ -3958,8 +4032,12 @@ LayerResult GCode::process_layer(
                 m_config.apply(instance_to_print.print_object.config(), true);
                 m_layer = layer_to_print.layer();
                 m_object_layer_over_raft = object_layer_over_raft;
-                if (m_config.reduce_crossing_wall)
-                    m_avoid_crossing_perimeters.init_layer(*m_layer);
+                if (m_config.reduce_crossing_wall) {
+                    if (avoid_crossing_perimeters != nullptr && avoid_crossing_perimeters->size() == layers.size() && (*avoid_crossing_perimeters)[instance_to_print.layer_id])
+                        m_avoid_crossing_perimeters.init_layer((*avoid_crossing_perimeters)[instance_to_print.layer_id]);
+                    else
+                        m_avoid_crossing_perimeters.init_layer(*m_layer);
+                }
 
                 if (this->config().gcode_label_objects) {
                     gcode += std::string("; printing object ") + instance_to_print.print_object.model_object()->name +
@@ -4557,33 +4635,164 @@ std::string GCode::extrude_support(const ExtrusionEntityCollection &support_fill
     return gcode;
 }
 
+GCode::GCodeOutputStream::GCodeOutputStream(FILE *f, GCodeProcessor &processor, size_t buffer_size, bool async) :
+    f(f), m_processor(processor), m_buffer_size(std::max<size_t>(buffer_size, 1)), m_async(f != nullptr && async)
+{
+    m_buffer.reserve(m_buffer_size);
+    if (m_async) {
+        m_writer.thread   = create_thread([this]() { this->run_consumer(m_writer, [this](const std::string &data) { this->write_buffer(data); }); });
+        m_analyzer.thread = create_thread([this]() { this->run_consumer(m_analyzer, [this](const std::string &data) { this->process_buffer(data); }); });
+    }
+}
+
 bool GCode::GCodeOutputStream::is_error() const
 {
-    return ::ferror(this->f);
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_error;
 }
 
 void GCode::GCodeOutputStream::flush()
 {
-    ::fflush(this->f);
+    if (this->f == nullptr)
+        return;
+    this->submit_buffer();
+    std::exception_ptr analyzer_exception;
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_condition.wait(lock, [this]() { return m_writer.idle() && m_analyzer.idle(); });
+        if (::fflush(this->f) != 0)
+            m_error = true;
+        std::swap(analyzer_exception, m_analyzer_exception);
+    }
+    if (analyzer_exception)
+        std::rethrow_exception(analyzer_exception);
 }
 
 void GCode::GCodeOutputStream::close()
 {
     if (this->f) {
+        this->submit_buffer();
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_stop = true;
+        }
+        m_condition.notify_all();
+        // The consumers finish their queues before they stop.
+        for (Consumer *consumer : { &m_writer, &m_analyzer })
+            if (consumer->thread.joinable())
+                consumer->thread.join();
+        if (::fflush(this->f) != 0)
+            m_error = true;
         ::fclose(this->f);
         this->f = nullptr;
     }
 }
 
+void GCode::GCodeOutputStream::write_buffer(const std::string &data)
+{
+    if (::fwrite(data.data(), 1, data.size(), this->f) != data.size()) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_error = true;
+    }
+}
+
+void GCode::GCodeOutputStream::process_buffer(const std::string &data)
+{
+    if (! m_async) {
+        m_processor.process_buffer(data);
+        return;
+    }
+    // Stop analyzing after a failure, the exception is rethrown by flush().
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_analyzer_exception)
+            return;
+    }
+    try {
+        m_processor.process_buffer(data);
+    } catch (...) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_analyzer_exception = std::current_exception();
+    }
+}
+
+template<typename ConsumeFn>
+void GCode::GCodeOutputStream::run_consumer(Consumer &consumer, ConsumeFn consume)
+{
+    // The locale is set per thread, GCodeProcessor parses numbers with the locale dependent functions.
+    CNumericLocalesSetter locales_setter;
+    for (;;) {
+        std::shared_ptr<const std::string> data;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_condition.wait(lock, [this, &consumer]() { return ! consumer.queue.empty() || m_stop; });
+            if (consumer.queue.empty())
+                return;
+            data = std::move(consumer.queue.front());
+            consumer.queue.pop_front();
+            consumer.busy = true;
+        }
+        // Let the producer queue another buffer while this one is being consumed.
+        m_condition.notify_all();
+        consume(*data);
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            consumer.busy = false;
+        }
+        m_condition.notify_all();
+    }
+}
+
+void GCode::GCodeOutputStream::submit(std::string &&data)
+{
+    if (! m_async) {
+        this->write_buffer(data);
+        this->process_buffer(data);
+        return;
+    }
+    // The writer and the analyzer share the buffer.
+    auto shared_data = std::make_shared<const std::string>(std::move(data));
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_condition.wait(lock, [this]() { return m_writer.queue.size() < 4 && m_analyzer.queue.size() < 4; });
+        m_writer.queue.emplace_back(shared_data);
+        m_analyzer.queue.emplace_back(std::move(shared_data));
+    }
+    m_condition.notify_all();
+}
+
+void GCode::GCodeOutputStream::submit_buffer()
+{
+    if (! m_buffer.empty()) {
+        std::string data;
+        data.reserve(m_buffer_size);
+        data.swap(m_buffer);
+        this->submit(std::move(data));
+    }
+}
+
 void GCode::GCodeOutputStream::write(const char *what)
 {
-    if (what != nullptr) {
-        const char* gcode = what;
-        // writes string to file
-        fwrite(gcode, 1, ::strlen(gcode), this->f);
-        //FIXME don't allocate a string, maybe process a batch of lines?
-        m_processor.process_buffer(std::string(gcode));
+    if (what != nullptr)
+        this->write(std::string(what));
+}
+
+void GCode::GCodeOutputStream::write(const std::string &what)
+{
+    m_buffer += what;
+    if (m_buffer.size() >= m_buffer_size)
+        this->submit_buffer();
+}
+
+void GCode::GCodeOutputStream::write(std::string &&what)
+{
+    if (what.size() < m_buffer_size) {
+        this->write(static_cast<const std::string&>(what));
+        return;
     }
+    // Keep the order of the data: Submit the buffered data first, then the large string as a whole.
+    this->submit_buffer();
+    this->submit(std::move(what));
 }
 
 void GCode::GCodeOutputStream::writeln(const std::string &what)
@@ -24,11 +24,17 @@
 
 #include "GCode/PressureEqualizer.hpp"
 
+#include <condition_variable>
+#include <deque>
+#include <exception>
 #include <memory>
 #include <map>
+#include <mutex>
 #include <set>
 #include <string>
 
+#include <boost/thread/thread.hpp>
+
 namespace Slic3r {
 
 // Forward declarations.
@@ -269,17 +275,27 @@ public:
 private:
     class GCodeOutputStream {
     public:
-        GCodeOutputStream(FILE *f, GCodeProcessor &processor) : f(f), m_processor(processor) {}
+        // Size of the buffer collecting the G-code before it is written into the file.
+        static constexpr const size_t DEFAULT_BUFFER_SIZE = 4 * 1024 * 1024;
+
+        // The G-code is collected into buffers of buffer_size, which are written into the file and passed to the GCodeProcessor.
+        // If async is set, the filled buffers are written into the file and analyzed by two background threads,
+        // so that the disk writes and the time estimation overlap with the generation of the following layers.
+        GCodeOutputStream(FILE *f, GCodeProcessor &processor, size_t buffer_size = DEFAULT_BUFFER_SIZE, bool async = false);
         ~GCodeOutputStream() { this->close(); }
 
         bool is_open() const { return f; }
         bool is_error() const;
 
+        // Write out the buffered data and wait until it is stored in the file and processed by the GCodeProcessor.
+        // Rethrows an exception thrown by the GCodeProcessor on the background thread.
         void flush();
         void close();
 
         // Write a string into a file.
-        void write(const std::string& what) { this->write(what.c_str()); }
+        void write(const std::string& what);
+        // Take over the string. A string larger than the buffer is handed over to the consumers without copying.
+        void write(std::string&& what);
         void write(const char* what);
 
         // Write a string into a file.
@@ -291,8 +307,38 @@ private:
         void write_format(const char* format, ...);
 
     private:
-        FILE *f = nullptr;
-        GCodeProcessor &m_processor;
+        // Background thread consuming the filled buffers in the order they were submitted.
+        struct Consumer
+        {
+            boost::thread                                   thread;
+            // Limited to a few buffers, so that a slow consumer blocks the producer instead of accumulating the whole G-code.
+            std::deque<std::shared_ptr<const std::string>>  queue;
+            bool                                            busy { false };
+
+            bool idle() const { return queue.empty() && ! busy; }
+        };
+
+        // Pass a filled buffer to the consumers, or write and analyze it directly if there are no background threads.
+        void submit(std::string &&data);
+        void submit_buffer();
+        void write_buffer(const std::string &data);
+        void process_buffer(const std::string &data);
+        template<typename ConsumeFn>
+        void run_consumer(Consumer &consumer, ConsumeFn consume);
+
+        FILE                        *f = nullptr;
+        GCodeProcessor              &m_processor;
+        size_t                       m_buffer_size;
+        std::string                  m_buffer;
+
+        bool                         m_async { false };
+        Consumer                     m_writer;
+        Consumer                     m_analyzer;
+        mutable std::mutex           m_mutex;
+        std::condition_variable      m_condition;
+        bool                         m_stop { false };
+        bool                         m_error { false };
+        std::exception_ptr           m_analyzer_exception;
     };
     void            _do_export(Print &print, GCodeOutputStream &file, ThumbnailsGeneratorCallback thumbnail_cb);
 
@@ -311,7 +357,24 @@ private:
         // Otherwise print a single copy of a single object.
         const size_t                     single_object_idx = size_t(-1),
         // BBS
-        const bool                       prime_extruder = false);
+        const bool                       prime_extruder = false,
+        // Boundaries for the extrusion quality estimator precalculated by process_layers(), one for each of layers.
+        // If null or empty, the boundaries are calculated in place.
+        std::vector<ExtrusionQualityEstimator::LayerBoundaries> *quality_estimator_boundaries = nullptr,
+        // Travel boundaries of AvoidCrossingPerimeters precalculated by process_layers(), one for each of layers.
+        // If null or empty, they are calculated in place.
+        const std::vector<AvoidCrossingPerimeters::LayerDataPtr> *avoid_crossing_perimeters = nullptr);
+    // Per-layer data, which does not depend on the state of the G-code generator.
+    // It is precalculated by a parallel stage of the process_layers() pipeline ahead of the serial process_layer().
+    struct LayerPrepared
+    {
+        // Index into layers_to_print. Index past the end marks the NOP layer inserted for the pressure equalizer.
+        size_t                                                  layer_to_print_idx { 0 };
+        // Filled in only if some region slows down over overhangs using the extrusion quality estimator.
+        std::vector<ExtrusionQualityEstimator::LayerBoundaries> quality_estimator_boundaries;
+        // Filled in only if reduce_crossing_wall is enabled.
+        std::vector<AvoidCrossingPerimeters::LayerDataPtr>      avoid_crossing_perimeters;
+    };
     // Process all layers of all objects (non-sequential mode) with a parallel pipeline:
     // Generate G-code, run the filters (vase mode, cooling buffer), run the G-code analyser
     // and export G-code into file.
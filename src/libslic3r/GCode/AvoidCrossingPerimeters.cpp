@@ -1187,14 +1187,27 @@ Polyline AvoidCrossingPerimeters::travel_to(const GCode &gcodegen, const Point &
     Vec2d endf   = end  .cast<double>();
 
     bool is_support_layer = dynamic_cast<const SupportLayer *>(gcodegen.layer()) != nullptr;
-    if (!use_external && (is_support_layer || (!m_lslices_offset.empty() && !any_expolygon_contains(m_lslices_offset, m_lslices_offset_bboxes, m_grid_lslices_offset, travel)))) {
-        // Initialize m_internal only when it is necessary.
-        if (m_internal.boundaries.empty())
-            init_boundary(&m_internal, to_polygons(get_boundary(*gcodegen.layer())));
+    const LayerData &layer_data = *m_layer_data;
+    if (!use_external && (is_support_layer || (!layer_data.lslices_offset.empty() && !any_expolygon_contains(layer_data.lslices_offset, layer_data.lslices_offset_bboxes, layer_data.grid_lslices_offset, travel)))) {
+        // Initialize the internal boundary only when it is necessary, unless it was precalculated for the current layer.
+        if (m_internal_boundary == nullptr) {
+            if (gcodegen.layer() == layer_data.internal_layer)
+                m_internal_boundary = &layer_data.internal;
+            else if (gcodegen.layer() == layer_data.internal_support_layer)
+                m_internal_boundary = &layer_data.internal_support;
+            else {
+                init_boundary(&m_internal, to_polygons(get_boundary(*gcodegen.layer())));
+                m_internal_boundary = &m_internal;
+            }
+        }
+        const Boundary &internal = *m_internal_boundary;
+        // An empty boundary is selected again by the next travel, which may be printing another layer.
+        if (internal.boundaries.empty())
+            m_internal_boundary = nullptr;
 
         // Trim the travel line by the bounding box.
-        if (!m_internal.boundaries.empty() && Geometry::liang_barsky_line_clipping(startf, endf, m_internal.bbox)) {
-            travel_intersection_count = avoid_perimeters(m_internal, startf.cast<coord_t>(), endf.cast<coord_t>(), *gcodegen.layer(), result_pl);
+        if (!internal.boundaries.empty() && Geometry::liang_barsky_line_clipping(startf, endf, internal.bbox)) {
+            travel_intersection_count = avoid_perimeters(internal, startf.cast<coord_t>(), endf.cast<coord_t>(), *gcodegen.layer(), result_pl);
             result_pl.points.front()  = start;
             result_pl.points.back()   = end;
         }
@@ -1237,32 +1250,61 @@ Polyline AvoidCrossingPerimeters::travel_to(const GCode &gcodegen, const Point &
     } else if (max_detour_length_exceeded) {
         *could_be_wipe_disabled = false;
     } else
-        *could_be_wipe_disabled = !need_wipe(gcodegen, m_lslices_offset, m_lslices_offset_bboxes, m_grid_lslices_offset, travel, result_pl, travel_intersection_count);
+        *could_be_wipe_disabled = !need_wipe(gcodegen, layer_data.lslices_offset, layer_data.lslices_offset_bboxes, layer_data.grid_lslices_offset, travel, result_pl, travel_intersection_count);
 
     return result_pl;
 }
 
 // ************************************* AvoidCrossingPerimeters::init_layer() *****************************************
 
-void AvoidCrossingPerimeters::init_layer(const Layer &layer)
+// Calculate the data for detection of perimeter crossings, the boundary for travels inside of the objects is left empty.
+static std::shared_ptr<AvoidCrossingPerimeters::LayerData> init_layer_data(const Layer &layer)
 {
-    m_internal.clear();
-    m_external.clear();
-    m_lslices_offset.clear();
-    m_lslices_offset_bboxes.clear();
+    auto layer_data = std::make_shared<AvoidCrossingPerimeters::LayerData>();
 
-    float perimeter_offset = -get_external_perimeter_width(layer) / float(2.);
-    m_lslices_offset        = offset_ex(layer.lslices, perimeter_offset);
+    float perimeter_offset     = -get_external_perimeter_width(layer) / float(2.);
+    layer_data->lslices_offset = offset_ex(layer.lslices, perimeter_offset);
 
-    m_lslices_offset_bboxes.reserve(m_lslices_offset.size());
-    for (const ExPolygon &ex_poly : m_lslices_offset)
-        m_lslices_offset_bboxes.emplace_back(get_extents(ex_poly));
+    layer_data->lslices_offset_bboxes.reserve(layer_data->lslices_offset.size());
+    for (const ExPolygon &ex_poly : layer_data->lslices_offset)
+        layer_data->lslices_offset_bboxes.emplace_back(get_extents(ex_poly));
 
     BoundingBox bbox_slice(get_extents(layer.lslices));
     bbox_slice.offset(SCALED_EPSILON);
 
-    m_grid_lslices_offset.set_bbox(bbox_slice);
-    m_grid_lslices_offset.create(m_lslices_offset, coord_t(scale_(1.)));
+    layer_data->grid_lslices_offset.set_bbox(bbox_slice);
+    layer_data->grid_lslices_offset.create(layer_data->lslices_offset, coord_t(scale_(1.)));
+    return layer_data;
+}
+
+void AvoidCrossingPerimeters::init_layer(const Layer &layer)
+{
+    m_internal.clear();
+    m_internal_boundary = nullptr;
+    m_external.clear();
+    m_layer_data = init_layer_data(layer);
+}
+
+void AvoidCrossingPerimeters::init_layer(LayerDataPtr layer_data)
+{
+    assert(layer_data);
+    m_internal.clear();
+    m_internal_boundary = nullptr;
+    m_external.clear();
+    m_layer_data = std::move(layer_data);
+}
+
+AvoidCrossingPerimeters::LayerDataPtr AvoidCrossingPerimeters::precalculate_layer(const Layer &layer, const Layer *support_layer)
+{
+    std::shared_ptr<LayerData> layer_data = init_layer_data(layer);
+    layer_data->internal_layer = &layer;
+    init_boundary(&layer_data->internal, to_polygons(get_boundary(layer)));
+    // The support layer differs from the object layer by the slices of the object layer below it, see get_boundary().
+    if (support_layer != nullptr && support_layer != &layer) {
+        layer_data->internal_support_layer = support_layer;
+        init_boundary(&layer_data->internal_support, to_polygons(get_boundary(*support_layer)));
+    }
+    return layer_data;
 }
 
 #if 0
@@ -9,6 +9,8 @@
 #include "../ExPolygon.hpp"
 #include "../EdgeGrid.hpp"
 
+#include <memory>
+
 namespace Slic3r {
 
 // Forward declarations.
@@ -54,6 +56,32 @@ public:
         }
     };
 
+    // Data of a single layer used to plan the travels inside of the objects. It depends on the layer only,
+    // therefore it may be calculated ahead of the G-code generator for many layers in parallel, see GCode::process_layers().
+    // It is shared by all instances of the layer, thus it is never modified once calculated.
+    struct LayerData {
+        // Lslices offseted by half an external perimeter width. Used for detection if line or polyline is inside of any polygon.
+        ExPolygons               lslices_offset;
+        std::vector<BoundingBox> lslices_offset_bboxes;
+        // Used for detection of line or polyline is inside of any polygon.
+        EdgeGrid::Grid           grid_lslices_offset;
+        // Boundaries for travels inside object, precalculated for the layer and for the support layer printed with it.
+        // Null layer if the boundary was not precalculated.
+        const Layer             *internal_layer { nullptr };
+        Boundary                 internal;
+        const Layer             *internal_support_layer { nullptr };
+        Boundary                 internal_support;
+    };
+    using LayerDataPtr = std::shared_ptr<const LayerData>;
+
+    // Calculate the data of a layer including the boundaries for travels inside of the objects of the layer
+    // and of the support layer printed together with it, which init_layer(const Layer&) leaves to be calculated
+    // by the first travel needing them.
+    // Thread safe.
+    static LayerDataPtr precalculate_layer(const Layer &layer, const Layer *support_layer);
+    // Initialize with data returned by precalculate_layer() for the layer being printed.
+    void        init_layer(LayerDataPtr layer_data);
+
 private:
     bool           m_use_external_mp { false };
     // just for the next travel move
@@ -62,13 +90,13 @@ private:
     // we enable it by default for the first travel move in print
     bool           m_disabled_once { true };
 
-    // Lslices offseted by half an external perimeter width. Used for detection if line or polyline is inside of any polygon.
-    ExPolygons               m_lslices_offset;
-    std::vector<BoundingBox> m_lslices_offset_bboxes;
-    // Used for detection of line or polyline is inside of any polygon.
-    EdgeGrid::Grid           m_grid_lslices_offset;
-    // Store all needed data for travels inside object
-    Boundary m_internal;
+    // Data of the current layer, shared with the pipeline precalculating it.
+    LayerDataPtr   m_layer_data { std::make_shared<LayerData>() };
+    // Boundary for travels inside object, calculated by the first travel needing it if it was not precalculated.
+    Boundary       m_internal;
+    // Boundary used by the travels inside object since the last init_layer(). The first travel needing it selects
+    // the boundary of the layer being printed at that time, which may be the support layer.
+    const Boundary *m_internal_boundary { nullptr };
     // Store all needed data for travels outside object
     Boundary m_external;
 };
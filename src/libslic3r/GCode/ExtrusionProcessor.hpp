@@ -256,16 +256,34 @@ class ExtrusionQualityEstimator
     const PrintObject                                                            *current_object;
 
 public:
+    // AABB trees over the boundaries and curled lines of a single object layer.
+    // They only depend on the layer itself, therefore they may be built ahead of time
+    // and in parallel with G-code generation of the preceding layers.
+    struct LayerBoundaries
+    {
+        LayerBoundaries() = default;
+        explicit LayerBoundaries(const Layer &layer) :
+            boundaries(to_unscaled_linesf(layer.lslices)), curled_extrusions(layer.curled_lines) {}
+
+        AABBTreeLines::LinesDistancer<Linef>      boundaries;
+        AABBTreeLines::LinesDistancer<CurledLine> curled_extrusions;
+    };
+
     void set_current_object(const PrintObject *object) { current_object = object; }
 
     void prepare_for_new_layer(const PrintObject * obj, const Layer *layer)
     {
         if (layer == nullptr) return;
-        const PrintObject *object = obj;
-        prev_layer_boundaries[object] = next_layer_boundaries[object];
-        next_layer_boundaries[object] = AABBTreeLines::LinesDistancer<Linef>{to_unscaled_linesf(layer->lslices)};
-        prev_curled_extrusions[object] = next_curled_extrusions[object];
-        next_curled_extrusions[object] = AABBTreeLines::LinesDistancer<CurledLine>{layer->curled_lines};
+        this->prepare_for_new_layer(obj, LayerBoundaries(*layer));
+    }
+
+    // Shift the current layer to the previous one and take over the precalculated boundaries of the new layer.
+    void prepare_for_new_layer(const PrintObject *object, LayerBoundaries &&layer_boundaries)
+    {
+        prev_layer_boundaries[object]  = std::move(next_layer_boundaries[object]);
+        next_layer_boundaries[object]  = std::move(layer_boundaries.boundaries);
+        prev_curled_extrusions[object] = std::move(next_curled_extrusions[object]);
+        next_curled_extrusions[object] = std::move(layer_boundaries.curled_extrusions);
     }
 
     std::vector<ProcessedPoint> estimate_extrusion_quality(const ExtrusionPath                &path,
@@ -2,7 +2,7 @@
 
 #include "GCodeReader.hpp"
 
-#include <iomanip>
+#include <fast_float/fast_float.h>
 /*
 #include <memory.h>
 #include <string.h>
@@ -53,11 +53,10 @@ float get_axis_value(const std::string& line, char axis)
     size_t pos = line.find(match) + 2;
     //size_t end = std::min(line.find(' ', pos + 1), line.find(';', pos + 1));
     // Try to parse the numeric value.
-    const char* c = line.c_str();
-    char* pend = nullptr;
-    errno = 0;
-    double  v = strtod(c + pos, &pend);
-    if (pend != nullptr && errno == 0 && pend != c) {
+    const char *c   = line.c_str() + pos;
+    double      v   = 0.;
+    auto [pend, ec] = fast_float::from_chars(c, line.c_str() + line.size(), v);
+    if (ec == std::errc() && pend != c) {
         // The axis value has been parsed correctly.
         return float(v);
     }
@@ -67,15 +66,12 @@ float get_axis_value(const std::string& line, char axis)
 void change_axis_value(std::string& line, char axis, const float new_value, const int decimal_digits)
 {
 
-    std::ostringstream ss;
-    ss << std::fixed << std::setprecision(decimal_digits) << new_value;
-
     char match[3] = " X";
     match[1] = axis;
 
     size_t pos = line.find(match) + 2;
     size_t end = std::min(line.find(' ', pos + 1), line.find(';', pos + 1));
-    line = line.replace(pos, end - pos, ss.str());
+    line = line.replace(pos, end - pos, GCodeFormatter::format_value(new_value, decimal_digits));
 }
 
 int16_t get_fan_speed(const std::string &line, GCodeFlavor flavor) {
@@ -4,6 +4,7 @@
 #include "libslic3r/Utils.hpp"
 #include "libslic3r/Print.hpp"
 #include "libslic3r/LocalesUtils.hpp"
+#include "libslic3r/Thread.hpp"
 #include "libslic3r/format.hpp"
 #include "GCodeProcessor.hpp"
 
@@ -851,6 +852,7 @@ void GCodeProcessorResult::reset() {
     lock();
 
     moves = std::vector<GCodeProcessorResult::MoveVertex>();
+    arc_interpolation_points = std::vector<Vec3f>();
     printable_area = Pointfs();
     //BBS: add bed exclude area
     bed_exclude_area = Pointfs();
@@ -878,6 +880,7 @@ void GCodeProcessorResult::reset() {
     lock();
 
     moves.clear();
+    arc_interpolation_points.clear();
     lines_ends.clear();
     printable_area = Pointfs();
     //BBS: add bed exclude area
@@ -1466,6 +1469,9 @@ static inline const char* remove_eols(const char *begin, const char *end) {
 void GCodeProcessor::process_file(const std::string& filename, std::function<void()> cancel_callback)
 {
     CNumericLocalesSetter locales_setter;
+    // GCodeReader::parse_file() tokenizes the lines and calls process_gcode_line() from the TBB worker threads,
+    // make sure they are set to the "C" locale as well.
+    name_tbb_thread_pool_threads_set_locale();
 
 #if ENABLE_GCODE_VIEWER_STATISTICS
     m_start_time = std::chrono::high_resolution_clock::now();
@@ -4197,14 +4203,18 @@ void GCodeProcessor::store_move_vertex(EMoveType type, EMovePathType path_type)
         ((type == EMoveType::Seam) ? m_last_line_id : m_line_id);
 
     //BBS: apply plate's and extruder's offset to arc interpolation points
+    uint32_t interpolation_points_offset = 0;
+    uint32_t interpolation_points_count  = 0;
     if (path_type == EMovePathType::Arc_move_cw ||
         path_type == EMovePathType::Arc_move_ccw) {
-        for (size_t i = 0; i < m_interpolation_points.size(); i++)
-            m_interpolation_points[i] =
-                Vec3f(m_interpolation_points[i].x() + m_x_offset,
-                      m_interpolation_points[i].y() + m_y_offset,
-                      m_processing_start_custom_gcode ? m_first_layer_height : m_interpolation_points[i].z()) +
-                m_extruder_offsets[m_extruder_id];
+        interpolation_points_offset = uint32_t(m_result.arc_interpolation_points.size());
+        interpolation_points_count  = uint32_t(m_interpolation_points.size());
+        for (const Vec3f &pt : m_interpolation_points)
+            m_result.arc_interpolation_points.emplace_back(
+                Vec3f(pt.x() + m_x_offset,
+                      pt.y() + m_y_offset,
+                      m_processing_start_custom_gcode ? m_first_layer_height : pt.z()) +
+                m_extruder_offsets[m_extruder_id]);
     }
 
     m_result.moves.push_back({
@@ -4227,7 +4237,8 @@ void GCodeProcessor::store_move_vertex(EMoveType type, EMovePathType path_type)
         //BBS: add arc move related data
         path_type,
         Vec3f(m_arc_center(0, 0) + m_x_offset, m_arc_center(1, 0) + m_y_offset, m_arc_center(2, 0)) + m_extruder_offsets[m_extruder_id],
-        m_interpolation_points,
+        interpolation_points_offset,
+        interpolation_points_count,
     });
 
     // stores stop time placeholders for later use
@@ -142,6 +142,7 @@ namespace Slic3r {
             }
         };
 
+        // Kept compact and free of heap allocations, the result of a large G-code holds tens of millions of moves.
         struct MoveVertex
         {
             unsigned int gcode_id{ 0 };
@@ -164,18 +165,38 @@ namespace Slic3r {
             //BBS: arc move related data
             EMovePathType move_path_type{ EMovePathType::Noop_move };
             Vec3f arc_center_position{ Vec3f::Zero() };      // mm
-            std::vector<Vec3f> interpolation_points;     // interpolation points of arc for drawing
+            // Interpolation points of arc for drawing, stored in GCodeProcessorResult::arc_interpolation_points
+            // to avoid a heap allocation per move. Use GCodeProcessorResult::interpolation_points() to access them.
+            uint32_t interpolation_points_offset{ 0 };
+            uint32_t interpolation_points_count{ 0 };
 
             float volumetric_rate() const { return feedrate * mm3_per_mm; }
             //BBS: new function to support arc move
             bool is_arc_move_with_interpolation_points() const {
-                return (move_path_type == EMovePathType::Arc_move_ccw || move_path_type == EMovePathType::Arc_move_cw) && interpolation_points.size();
+                return (move_path_type == EMovePathType::Arc_move_ccw || move_path_type == EMovePathType::Arc_move_cw) && interpolation_points_count > 0;
             }
             bool is_arc_move() const {
                 return move_path_type == EMovePathType::Arc_move_ccw || move_path_type == EMovePathType::Arc_move_cw;
             }
         };
 
+        // Read only view of the arc interpolation points of a single move.
+        class InterpolationPoints
+        {
+        public:
+            InterpolationPoints(const Vec3f *begin, size_t size) : m_begin(begin), m_size(size) {}
+
+            size_t          size()  const { return m_size; }
+            bool            empty() const { return m_size == 0; }
+            const Vec3f*    begin() const { return m_begin; }
+            const Vec3f*    end()   const { return m_begin + m_size; }
+            const Vec3f&    operator[](size_t idx) const { assert(idx < m_size); return m_begin[idx]; }
+
+        private:
+            const Vec3f    *m_begin;
+            size_t          m_size;
+        };
+
         struct SliceWarning {
             int         level;                  // 0: normal tips, 1: warning; 2: error
             std::string msg;                    // enum string
@@ -186,6 +207,8 @@ namespace Slic3r {
         std::string filename;
         unsigned int id;
         std::vector<MoveVertex> moves;
+        // Arc interpolation points of all the moves, referenced by MoveVertex::interpolation_points_offset / count.
+        std::vector<Vec3f> arc_interpolation_points;
         // Positions of ends of lines of the final G-code this->filename after TimeProcessor::post_process() finalizes the G-code.
         std::vector<size_t> lines_ends;
         Pointfs printable_area;
@@ -219,6 +242,10 @@ namespace Slic3r {
 #endif // ENABLE_GCODE_VIEWER_STATISTICS
         void reset();
 
+        InterpolationPoints interpolation_points(const MoveVertex &move) const {
+            return { arc_interpolation_points.data() + move.interpolation_points_offset, move.interpolation_points_count };
+        }
+
         //BBS: add mutex for protection of gcode result
         mutable std::mutex result_mutex;
         GCodeProcessorResult& operator=(const GCodeProcessorResult &other)
@@ -226,6 +253,7 @@ namespace Slic3r {
             filename = other.filename;
             id = other.id;
             moves = other.moves;
+            arc_interpolation_points = other.arc_interpolation_points;
             lines_ends = other.lines_ends;
             printable_area = other.printable_area;
             bed_exclude_area = other.bed_exclude_area;
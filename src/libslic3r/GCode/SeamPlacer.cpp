@@ -9,6 +9,13 @@
 #include <random>
 #include <algorithm>
 #include <queue>
+#include <array>
+#include <deque>
+#include <mutex>
+#include <unordered_map>
+
+#include <boost/functional/hash.hpp>
+#include <openssl/md5.h>
 
 #include "libslic3r/AABBTreeLines.hpp"
 #include "libslic3r/KDTreeIndirect.hpp"
@@ -147,6 +154,8 @@ std::vector<float> raycast_visibility(const AABBTreeIndirect::Tree<3, float> &ra
   }
 
   bool model_contains_negative_parts = negative_volumes_start_index < triangles.indices.size();
+  // Number of rays traversing the AABB tree together if there are no negative volumes.
+  static constexpr const size_t ray_packet_size = 8;
 
   std::vector<float> result(samples.positions.size());
   tbb::parallel_for(tbb::blocked_range<size_t>(0, result.size()),
@@ -165,20 +174,30 @@ std::vector<float> raycast_visibility(const AABBTreeIndirect::Tree<3, float> &ra
                         Frame f;
                         f.set_from_z(normal);
 
-                        for (const auto &dir : precomputed_sample_directions) {
-                          Vec3f final_ray_dir = (f.to_world(dir));
-                          if (!model_contains_negative_parts) {
-                            igl::Hit hitpoint;
-                            // FIXME: This AABBTTreeIndirect query will not compile for float ray origin and
-                            // direction.
-                            Vec3d final_ray_dir_d = final_ray_dir.cast<double>();
-                            Vec3d ray_origin_d = (center + normal * 0.01f).cast<double>(); // start above surface.
-                            bool hit = AABBTreeIndirect::intersect_ray_first_hit(triangles.vertices,
-                                                                                 triangles.indices, raycasting_tree, ray_origin_d, final_ray_dir_d, hitpoint);
-                            if (hit && its_face_normal(triangles, hitpoint.id).dot(final_ray_dir) <= 0) {
-                              result[s_idx] -= decrease_step;
-                            }
-                          } else { //TODO improve logic for order based boolean operations - consider order of volumes
+                        if (!model_contains_negative_parts) {
+                          // All the rays start at the same point above the surface, shoot them in packets
+                          // sharing the traversal of the AABB tree.
+                          // FIXME: This AABBTTreeIndirect query will not compile for float ray origin and
+                          // direction.
+                          std::array<Vec3d, ray_packet_size> ray_origins;
+                          std::array<Vec3d, ray_packet_size> ray_dirs;
+                          std::array<igl::Hit, ray_packet_size> hitpoints;
+                          ray_origins.fill((center + normal * 0.01f).cast<double>()); // start above surface.
+                          for (size_t dir_idx = 0; dir_idx < precomputed_sample_directions.size(); dir_idx += ray_packet_size) {
+                            size_t num_rays = std::min(ray_packet_size, precomputed_sample_directions.size() - dir_idx);
+                            for (size_t i = 0; i < num_rays; ++i)
+                              ray_dirs[i] = f.to_world(precomputed_sample_directions[dir_idx + i]).cast<double>();
+                            uint32_t hit_mask = AABBTreeIndirect::intersect_ray_packet_first_hit(triangles.vertices,
+                                triangles.indices, raycasting_tree, ray_origins.data(), ray_dirs.data(), num_rays, hitpoints);
+                            for (size_t i = 0; i < num_rays; ++i)
+                              if ((hit_mask >> i) & 1
+                                  && its_face_normal(triangles, hitpoints[i].id).dot(ray_dirs[i].cast<float>()) <= 0) {
+                                result[s_idx] -= decrease_step;
+                              }
+                          }
+                        } else { //TODO improve logic for order based boolean operations - consider order of volumes
+                          for (const auto &dir : precomputed_sample_directions) {
+                            Vec3f final_ray_dir = (f.to_world(dir));
                             bool casting_from_negative_volume = samples.triangle_indices[s_idx]
                                                                 >= negative_volumes_start_index;
 
@@ -615,9 +634,129 @@ std::pair<size_t, size_t> find_previous_and_next_perimeter_point(const std::vect
   return {size_t(prev),size_t(next)};
 }
 
+// Visibility of the mesh samples, the result of the raycasting.
+struct OcclusionSamples {
+  TriangleSetSamples mesh_samples;
+  std::vector<float> mesh_samples_visibility;
+  float mesh_samples_radius;
+};
+
+// Identity of the geometry the rays were cast against: The model parts and negative volumes of the object
+// placed by the object transformation. The meshes are identified by their sizes and by a MD5 digest of their content,
+// so that the cache does not keep the meshes of deleted or reloaded objects alive.
+struct OcclusionKey {
+  struct Volume {
+    ModelVolumeType type;
+    Transform3d matrix;
+    size_t num_vertices;
+    size_t num_indices;
+    std::array<unsigned char, MD5_DIGEST_LENGTH> digest;
+  };
+
+  explicit OcclusionKey(const PrintObject *po) : trafo(po->trafo_centered()) {
+    auto hash_range = [](size_t &seed, const auto *begin, const auto *end) {
+      for (; begin != end; ++begin)
+        boost::hash_combine(seed, *begin);
+    };
+    hash_range(hash, trafo.data(), trafo.data() + 16);
+    for (const ModelVolume *model_volume : po->model_object()->volumes) {
+      if (model_volume->type() != ModelVolumeType::MODEL_PART
+          && model_volume->type() != ModelVolumeType::NEGATIVE_VOLUME)
+        continue;
+      const indexed_triangle_set &its = model_volume->mesh().its;
+      Volume volume { model_volume->type(), model_volume->get_matrix(), its.vertices.size(), its.indices.size(), {} };
+      MD5_CTX ctx;
+      MD5_Init(&ctx);
+      MD5_Update(&ctx, its.vertices.data(), its.vertices.size() * sizeof(stl_vertex));
+      MD5_Update(&ctx, its.indices.data(), its.indices.size() * sizeof(stl_triangle_vertex_indices));
+      MD5_Final(volume.digest.data(), &ctx);
+      boost::hash_combine(hash, int(volume.type));
+      hash_range(hash, volume.matrix.data(), volume.matrix.data() + 16);
+      boost::hash_combine(hash, volume.num_vertices);
+      boost::hash_combine(hash, volume.num_indices);
+      hash_range(hash, volume.digest.data(), volume.digest.data() + volume.digest.size());
+      volumes.emplace_back(std::move(volume));
+    }
+  }
+
+  bool operator==(const OcclusionKey &rhs) const {
+    if (hash != rhs.hash || trafo.matrix() != rhs.trafo.matrix() || volumes.size() != rhs.volumes.size())
+      return false;
+    for (size_t i = 0; i < volumes.size(); ++i) {
+      const Volume &lhs_volume = volumes[i];
+      const Volume &rhs_volume = rhs.volumes[i];
+      if (lhs_volume.type != rhs_volume.type || lhs_volume.matrix.matrix() != rhs_volume.matrix.matrix()
+          || lhs_volume.num_vertices != rhs_volume.num_vertices || lhs_volume.num_indices != rhs_volume.num_indices
+          || lhs_volume.digest != rhs_volume.digest)
+        return false;
+    }
+    return true;
+  }
+
+  Transform3d trafo;
+  std::vector<Volume> volumes;
+  // Only used to distribute the keys into the buckets of the cache.
+  size_t hash { 0 };
+};
+
+struct OcclusionKeyHash {
+  size_t operator()(const OcclusionKey &key) const { return key.hash; }
+};
+
+// Process wide cache of the raycasting results, keyed by the geometry the rays were cast against,
+// so that identical objects and objects re-sliced with unchanged geometry skip the raycasting.
+class OcclusionCache {
+public:
+  static OcclusionCache& instance() { static OcclusionCache cache; return cache; }
+
+  std::shared_ptr<const OcclusionSamples> find(const OcclusionKey &key) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto it = m_map.find(key);
+    return it == m_map.end() ? nullptr : it->second;
+  }
+
+  void insert(const OcclusionKey &key, std::shared_ptr<const OcclusionSamples> samples) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (auto [it, inserted] = m_map.emplace(key, std::move(samples)); inserted) {
+      // Keys of the map are stable, the FIFO refers to them.
+      m_fifo.emplace_back(&it->first);
+      if (m_fifo.size() > MAX_ENTRIES) {
+        m_map.erase(*m_fifo.front());
+        m_fifo.pop_front();
+      }
+    }
+  }
+
+private:
+  // Each entry holds SeamPlacer::raycasting_visibility_samples_count samples, roughly 1MB, and a key of a few hundred bytes per volume.
+  static constexpr const size_t MAX_ENTRIES = 32;
+
+  std::mutex m_mutex;
+  std::unordered_map<OcclusionKey, std::shared_ptr<const OcclusionSamples>, OcclusionKeyHash> m_map;
+  std::deque<const OcclusionKey*> m_fifo;
+};
+
+// Builds the KD tree over the mesh samples, which are already filled in.
+void build_mesh_samples_tree(GlobalModelInfo &result) {
+  result.mesh_samples_coordinate_functor = CoordinateFunctor(&result.mesh_samples.positions);
+  result.mesh_samples_tree = KDTreeIndirect<3, float, CoordinateFunctor>(result.mesh_samples_coordinate_functor,
+                                                                         result.mesh_samples.positions.size());
+}
+
 // Computes all global model info - transforms object, performs raycasting
 void compute_global_occlusion(GlobalModelInfo &result, const PrintObject *po,
                               std::function<void(void)> throw_if_canceled) {
+  const OcclusionKey occlusion_key(po);
+  if (std::shared_ptr<const OcclusionSamples> cached = OcclusionCache::instance().find(occlusion_key); cached) {
+    BOOST_LOG_TRIVIAL(debug)
+        << "SeamPlacer: reusing cached visibility samples";
+    result.mesh_samples = cached->mesh_samples;
+    result.mesh_samples_visibility = cached->mesh_samples_visibility;
+    result.mesh_samples_radius = cached->mesh_samples_radius;
+    build_mesh_samples_tree(result);
+    return;
+  }
+
   BOOST_LOG_TRIVIAL(debug)
       << "SeamPlacer: gather occlusion meshes: start";
   auto obj_transform = po->trafo_centered();
@@ -658,9 +797,7 @@ void compute_global_occlusion(GlobalModelInfo &result, const PrintObject *po,
 
   result.mesh_samples = sample_its_uniform_parallel(SeamPlacer::raycasting_visibility_samples_count,
                                                     triangle_set);
-  result.mesh_samples_coordinate_functor = CoordinateFunctor(&result.mesh_samples.positions);
-  result.mesh_samples_tree = KDTreeIndirect<3, float, CoordinateFunctor>(result.mesh_samples_coordinate_functor,
-                                                                         result.mesh_samples.positions.size());
+  build_mesh_samples_tree(result);
 
   // The following code determines search area for random visibility samples on the mesh when calculating visibility of each perimeter point
   // number of random samples in the given radius (area) is approximately poisson distribution
@@ -694,6 +831,8 @@ void compute_global_occlusion(GlobalModelInfo &result, const PrintObject *po,
   result.mesh_samples_visibility = raycast_visibility(raycasting_tree, triangle_set, result.mesh_samples,
                                                       negative_volumes_start_index);
   throw_if_canceled();
+  OcclusionCache::instance().insert(occlusion_key, std::make_shared<const OcclusionSamples>(
+      OcclusionSamples { result.mesh_samples, result.mesh_samples_visibility, result.mesh_samples_radius }));
 #ifdef DEBUG_FILES
   result.debug_export(triangle_set);
 #endif
@@ -1,6 +1,5 @@
 #include "SpiralVase.hpp"
 #include "GCode.hpp"
-#include <sstream>
 
 namespace Slic3r {
 
@@ -21,35 +20,42 @@ std::string SpiralVase::process_layer(const std::string &gcode)
         return gcode;
     }
     
+    // Parse the layer once, remember the lines with their moves relative to the preceding position.
+    struct Move {
+        GCodeReader::GCodeLine line;
+        float                  dist_XY   { 0.f };
+        bool                   extruding { false };
+    };
+    std::vector<Move> moves;
     // Get total XY length for this layer by summing all extrusion moves.
     float total_layer_length = 0;
     float layer_height = 0;
     float z = 0.f;
-    
-    {
-        //FIXME Performance warning: This copies the GCodeConfig of the reader.
-        GCodeReader r = m_reader;  // clone
-        bool set_z = false;
-        r.parse_buffer(gcode, [&total_layer_length, &layer_height, &z, &set_z]
-            (GCodeReader &reader, const GCodeReader::GCodeLine &line) {
-            if (line.cmd_is("G1")) {
-                if (line.extruding(reader)) {
-                    total_layer_length += line.dist_XY(reader);
-                } else if (line.has(Z)) {
-                    layer_height += line.dist_Z(reader);
-                    if (!set_z) {
-                        z = line.new_Z(reader);
-                        set_z = true;
-                    }
+    bool  set_z = false;
+    m_reader.parse_buffer(gcode, [&moves, &total_layer_length, &layer_height, &z, &set_z]
+        (GCodeReader &reader, const GCodeReader::GCodeLine &line) {
+        Move move { line };
+        if (line.cmd_is("G1")) {
+            move.dist_XY   = line.dist_XY(reader);
+            move.extruding = line.extruding(reader);
+            if (move.extruding) {
+                total_layer_length += move.dist_XY;
+            } else if (line.has(Z)) {
+                layer_height += line.dist_Z(reader);
+                if (!set_z) {
+                    z = line.new_Z(reader);
+                    set_z = true;
                 }
             }
-        });
-    }
+        }
+        moves.emplace_back(std::move(move));
+    });
     
-    // Remove layer height from initial Z.
+    // Remove layer height from initial Z.
     z -= layer_height;
     
     std::string new_gcode;
+    new_gcode.reserve(gcode.size());
     //FIXME Tapering of the transition layer only works reliably with relative extruder distances.
     // For absolute extruder distances it will be switched off.
     // Tapering the absolute extruder distances requires to process every extrusion value after the first transition
@@ -57,39 +63,36 @@ std::string SpiralVase::process_layer(const std::string &gcode)
     bool  transition = m_transition_layer && m_config.use_relative_e_distances.value;
     float layer_height_factor = layer_height / total_layer_length;
     float len = 0.f;
-    m_reader.parse_buffer(gcode, [&new_gcode, &z, total_layer_length, layer_height_factor, transition, &len]
-        (GCodeReader &reader, GCodeReader::GCodeLine line) {
+    for (Move &move : moves) {
+        GCodeReader::GCodeLine &line = move.line;
         if (line.cmd_is("G1")) {
             if (line.has_z()) {
                 // If this is the initial Z move of the layer, replace it with a
                 // (redundant) move to the last Z of previous layer.
-                line.set(reader, Z, z);
+                line.set(m_reader, Z, z);
                 new_gcode += line.raw() + '\n';
-                return;
-            } else {
-                float dist_XY = line.dist_XY(reader);
-                if (dist_XY > 0) {
-                    // horizontal move
-                    if (line.extruding(reader)) {
-                        len += dist_XY;
-                        line.set(reader, Z, z + len * layer_height_factor);
-                        if (transition && line.has(E))
-                            // Transition layer, modulate the amount of extrusion from zero to the final value.
-                            line.set(reader, E, line.value(E) * len / total_layer_length);
-                        new_gcode += line.raw() + '\n';
-                    }
-                    return;
-                
-                    /*  Skip travel moves: the move to first perimeter point will
-                        cause a visible seam when loops are not aligned in XY; by skipping
-                        it we blend the first loop move in the XY plane (although the smoothness
-                        of such blend depend on how long the first segment is; maybe we should
-                        enforce some minimum length?).  */
+                continue;
+            } else if (move.dist_XY > 0) {
+                // horizontal move
+                if (move.extruding) {
+                    len += move.dist_XY;
+                    line.set(m_reader, Z, z + len * layer_height_factor);
+                    if (transition && line.has(E))
+                        // Transition layer, modulate the amount of extrusion from zero to the final value.
+                        line.set(m_reader, E, line.value(E) * len / total_layer_length);
+                    new_gcode += line.raw() + '\n';
                 }
+                continue;
+            
+                /*  Skip travel moves: the move to first perimeter point will
+                    cause a visible seam when loops are not aligned in XY; by skipping
+                    it we blend the first loop move in the XY plane (although the smoothness
+                    of such blend depend on how long the first segment is; maybe we should
+                    enforce some minimum length?).  */
             }
         }
         new_gcode += line.raw() + '\n';
-    });
+    }
     
     return new_gcode;
 }
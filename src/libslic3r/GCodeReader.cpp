@@ -1,10 +1,16 @@
 #include "GCodeReader.hpp"
+#include "GCodeWriter.hpp"
 #include <boost/algorithm/string/classification.hpp>
 #include <boost/algorithm/string/split.hpp>
 #include <boost/nowide/fstream.hpp>
 #include <boost/nowide/cstdio.hpp>
+#include <boost/filesystem/operations.hpp>
+#include <boost/iostreams/device/mapped_file.hpp>
+#include <boost/log/trivial.hpp>
+#include <boost/format.hpp>
 #include <fstream>
 #include <iostream>
+#include <atomic>
 #include <iomanip>
 #include "Utils.hpp"
 
@@ -13,6 +19,23 @@
 #include <Shiny/Shiny.h>
 #include <fast_float/fast_float.h>
 
+#include <tbb/task_arena.h>
+// Intel redesigned some TBB interface considerably when merging TBB with their oneAPI set of libraries, see GH #7332.
+// We are using quite an old TBB 2017 U7. Before we update our build servers, let's use the old API, which is deprecated in up to date TBB.
+#if ! defined(TBB_VERSION_MAJOR)
+    #include <tbb/version.h>
+#endif
+#if ! defined(TBB_VERSION_MAJOR)
+    static_assert(false, "TBB_VERSION_MAJOR not defined");
+#endif
+#if TBB_VERSION_MAJOR >= 2021
+    #include <tbb/parallel_pipeline.h>
+    using slic3r_tbb_filtermode = tbb::filter_mode;
+#else
+    #include <tbb/pipeline.h>
+    using slic3r_tbb_filtermode = tbb::filter;
+#endif
+
 namespace Slic3r {
 
 void GCodeReader::apply_config(const GCodeConfig &config)
@@ -82,9 +105,6 @@ const char* GCodeReader::parse_line_internal(const char *ptr, const char *end, G
         }
     }
     
-    if (gline.has(E) && m_config.use_relative_e_distances)
-        m_position[E] = 0;
-
     // Skip the rest of the line.
     for (; ! is_end_of_line(*c); ++ c);
 
@@ -121,10 +141,70 @@ void GCodeReader::update_coordinates(GCodeLine &gline, std::pair<const char*, co
     }
 }
 
+// Returns false if the file could not be mapped. An empty file is not mapped, but true is returned.
+static bool map_file(const std::string &filename, boost::iostreams::mapped_file_source &file)
+{
+    try {
+        if (boost::filesystem::file_size(boost::filesystem::path(filename)) > 0)
+            // An empty file cannot be mapped.
+            file.open(boost::filesystem::path(filename));
+        return true;
+    } catch (const std::exception &err) {
+        BOOST_LOG_TRIVIAL(warning) << "GCodeReader: cannot map " << filename << " into memory (" << err.what() << "), reading it by chunks";
+    }
+    return false;
+}
+
 template<typename ParseLineCallback, typename LineEndCallback>
 bool GCodeReader::parse_file_raw_internal(const std::string &filename, ParseLineCallback parse_line_callback, LineEndCallback line_end_callback)
+{
+    // Parse the file straight from a memory mapping, the lines are passed to the callback without copying.
+    boost::iostreams::mapped_file_source file;
+    if (! map_file(filename, file))
+        return this->parse_file_raw_chunked(filename, parse_line_callback, line_end_callback);
+    if (! file.is_open())
+        // Empty file.
+        return true;
+
+    const char *begin = file.data();
+    const char *end   = begin + file.size();
+    const char *it    = begin;
+    m_parsing = true;
+    while (it != end) {
+        // Find end of line. memchr() is vectorized by the C runtime, a line of G-code ends with '\n' in all but very old files.
+        const char *it_end = static_cast<const char*>(::memchr(it, '\n', end - it));
+        if (it_end == nullptr)
+            it_end = end;
+        if (const char *cr = static_cast<const char*>(::memchr(it, '\r', it_end - it)); cr != nullptr)
+            it_end = cr;
+        if (it_end == end) {
+            // The last line is not terminated, make a copy terminated with zero for the parser.
+            std::string gcode_line(it, end);
+            parse_line_callback(gcode_line.c_str(), gcode_line.c_str() + gcode_line.size());
+            return true;
+        }
+        parse_line_callback(it, it_end);
+        if (! m_parsing)
+            // The callback wishes to exit.
+            return true;
+        // Skip EOL.
+        it = it_end;
+        if (it != end && *it == '\r')
+            ++ it;
+        if (it != end && *it == '\n') {
+            line_end_callback(size_t(it - begin) + 1);
+            ++ it;
+        }
+    }
+    return true;
+}
+
+template<typename ParseLineCallback, typename LineEndCallback>
+bool GCodeReader::parse_file_raw_chunked(const std::string &filename, ParseLineCallback parse_line_callback, LineEndCallback line_end_callback)
 {
     FilePtr in{ boost::nowide::fopen(filename.c_str(), "rb") };
+    if (in.f == nullptr)
+        return false;
 
     // Read the input stream 64kB at a time, extract lines and process them.
     std::vector<char> buffer(65536 * 10, 0);
@@ -177,22 +257,122 @@ bool GCodeReader::parse_file_raw_internal(const std::string &filename, ParseLine
     return true;
 }
 
+// Lines of a block of the G-code file tokenized by a parallel stage of GCodeReader::parse_file_internal().
+struct GCodeReader::ParsedChunk
+{
+    // The storage is reused for the following blocks to keep the capacity of the raw strings of the lines.
+    std::vector<GCodeLine>                              lines;
+    std::vector<std::pair<const char*, const char*>>    commands;
+    // File offsets after the '\n' ending each line, zero if the line is not terminated by '\n'.
+    std::vector<size_t>                                 line_ends;
+    size_t                                              num_lines { 0 };
+    // Copy of an unterminated last line of the file.
+    std::string                                         last_line;
+};
+
 template<typename ParseLineCallback, typename LineEndCallback>
 bool GCodeReader::parse_file_internal(const std::string &filename, ParseLineCallback parse_line_callback, LineEndCallback line_end_callback)
 {
-    GCodeLine gline;    
-    return this->parse_file_raw_internal(filename, 
-        [this, &gline, parse_line_callback](const char *begin, const char *end) {
-            gline.reset();
-
-            const char* begin_new = begin;
-            begin_new = skip_whitespaces(begin_new);
-            if (std::toupper(*begin_new) == 'N')
-                begin_new = skip_word(begin_new);
-            begin_new = skip_whitespaces(begin_new);
-            this->parse_line(begin_new, end, gline, parse_line_callback);
-        }, 
-        line_end_callback);
+    boost::iostreams::mapped_file_source file;
+    if (! map_file(filename, file)) {
+        GCodeLine gline;
+        return this->parse_file_raw_chunked(filename,
+            [this, &gline, parse_line_callback](const char *begin, const char *end) {
+                gline.reset();
+                this->parse_line(skip_line_number(begin), end, gline, parse_line_callback);
+            },
+            line_end_callback);
+    }
+    if (! file.is_open())
+        // Empty file.
+        return true;
+
+    // The lines are tokenized by a parallel stage of a pipeline, while the callback processes the already tokenized lines
+    // in a serial stage, so that the parsing overlaps with the processing of the lines by the callback.
+    static constexpr const size_t chunk_size = 1024 * 1024;
+    const size_t                  max_chunks = 2 * std::max<size_t>(tbb::this_task_arena::max_concurrency(), 1);
+    std::vector<ParsedChunk>      chunks(max_chunks);
+    const char                   *file_begin = file.data();
+    const char                   *file_end   = file_begin + file.size();
+    const char                   *next       = file_begin;
+    size_t                        chunk_idx  = 0;
+    std::atomic<bool>             stop { false };
+    m_parsing = true;
+
+    struct Block {
+        const char  *begin;
+        const char  *end;
+        ParsedChunk *chunk;
+    };
+    const auto split = tbb::make_filter<void, Block>(slic3r_tbb_filtermode::serial_in_order,
+        [&](tbb::flow_control &fc) -> Block {
+            if (next == file_end || stop) {
+                fc.stop();
+                return {};
+            }
+            // End the block after a '\n'.
+            const char *end = file_end;
+            if (size_t(file_end - next) > chunk_size) {
+                end = static_cast<const char*>(::memchr(next + chunk_size, '\n', file_end - next - chunk_size));
+                end = end == nullptr ? file_end : end + 1;
+            }
+            // At most max_chunks blocks are in flight and they are processed in order, thus the chunk storage may be cycled.
+            Block block { next, end, &chunks[chunk_idx ++ % max_chunks] };
+            next = end;
+            return block;
+        });
+    const auto tokenize = tbb::make_filter<Block, ParsedChunk*>(slic3r_tbb_filtermode::parallel,
+        [this, file_begin, file_end](const Block &block) -> ParsedChunk* {
+            ParsedChunk &chunk = *block.chunk;
+            chunk.num_lines = 0;
+            for (const char *it = block.begin; it != block.end;) {
+                const char *it_end = static_cast<const char*>(::memchr(it, '\n', block.end - it));
+                if (it_end == nullptr)
+                    it_end = block.end;
+                if (const char *cr = static_cast<const char*>(::memchr(it, '\r', it_end - it)); cr != nullptr)
+                    it_end = cr;
+                if (chunk.num_lines == chunk.lines.size()) {
+                    chunk.lines.emplace_back();
+                    chunk.commands.emplace_back();
+                    chunk.line_ends.emplace_back();
+                }
+                GCodeLine &gline = chunk.lines[chunk.num_lines];
+                gline.reset();
+                size_t line_end = 0;
+                if (it_end == file_end) {
+                    // The last line is not terminated, make a copy terminated with zero for the parser.
+                    chunk.last_line.assign(it, it_end);
+                    this->parse_line_internal(skip_line_number(chunk.last_line.c_str()), chunk.last_line.c_str() + chunk.last_line.size(), gline, chunk.commands[chunk.num_lines]);
+                    it = it_end;
+                } else {
+                    this->parse_line_internal(skip_line_number(it), it_end, gline, chunk.commands[chunk.num_lines]);
+                    // Skip EOL.
+                    it = it_end;
+                    if (it != block.end && *it == '\r')
+                        ++ it;
+                    if (it != block.end && *it == '\n')
+                        line_end = size_t(++ it - file_begin);
+                }
+                chunk.line_ends[chunk.num_lines ++] = line_end;
+            }
+            return &chunk;
+        });
+    const auto process = tbb::make_filter<ParsedChunk*, void>(slic3r_tbb_filtermode::serial_in_order,
+        [this, &stop, parse_line_callback, line_end_callback](ParsedChunk *chunk) {
+            for (size_t i = 0; i < chunk->num_lines && ! stop; ++ i) {
+                GCodeLine &gline = chunk->lines[i];
+                this->reset_relative_e(gline);
+                parse_line_callback(*this, gline);
+                this->update_coordinates(gline, chunk->commands[i]);
+                if (! m_parsing)
+                    // The callback wishes to exit.
+                    stop = true;
+                else if (chunk->line_ends[i] != 0)
+                    line_end_callback(chunk->line_ends[i]);
+            }
+        });
+    tbb::parallel_pipeline(max_chunks, split & tokenize & process);
+    return true;
 }
 
 bool GCodeReader::parse_file(const std::string &file, callback_t callback)
@@ -276,8 +456,7 @@ bool GCodeReader::GCodeLine::has_value(char axis, float &value) const
 
 void GCodeReader::GCodeLine::set(const GCodeReader &reader, const Axis axis, const float new_value, const int decimal_digits)
 {
-    std::ostringstream ss;
-    ss << std::fixed << std::setprecision(decimal_digits) << new_value;
+    const std::string value = GCodeFormatter::format_value(new_value, decimal_digits);
 
     char match[3] = " X";
     if (int(axis) < 3)
@@ -297,13 +476,13 @@ void GCodeReader::GCodeLine::set(const GCodeReader &reader, const Axis axis, con
     if (this->has(axis)) {
         size_t pos = m_raw.find(match)+2;
         size_t end = m_raw.find(' ', pos+1);
-        m_raw = m_raw.replace(pos, end-pos, ss.str());
+        m_raw = m_raw.replace(pos, end-pos, value);
     } else {
         size_t pos = m_raw.find(' ');
         if (pos == std::string::npos)
-            m_raw += std::string(match) + ss.str();
+            m_raw += std::string(match) + value;
         else
-            m_raw = m_raw.replace(pos, 0, std::string(match) + ss.str());
+            m_raw = m_raw.replace(pos, 0, std::string(match) + value);
     }
     m_axis[axis] = new_value;
     m_mask |= 1 << int(axis);
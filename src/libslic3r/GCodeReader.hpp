@@ -114,6 +114,7 @@ public:
     {
         std::pair<const char*, const char*> cmd;
         const char *line_end = parse_line_internal(ptr, end, gline, cmd);
+        this->reset_relative_e(gline);
         callback(*this, gline);
         update_coordinates(gline, cmd);
         return line_end;
@@ -153,11 +154,26 @@ public:
 private:
     template<typename ParseLineCallback, typename LineEndCallback>
     bool        parse_file_raw_internal(const std::string &filename, ParseLineCallback parse_line_callback, LineEndCallback line_end_callback);
+    // Fallback of parse_file_raw_internal() for files, which cannot be memory mapped.
+    template<typename ParseLineCallback, typename LineEndCallback>
+    bool        parse_file_raw_chunked(const std::string &filename, ParseLineCallback parse_line_callback, LineEndCallback line_end_callback);
     template<typename ParseLineCallback, typename LineEndCallback>
     bool        parse_file_internal(const std::string &filename, ParseLineCallback parse_line_callback, LineEndCallback line_end_callback);
 
     const char* parse_line_internal(const char *ptr, const char *end, GCodeLine &gline, std::pair<const char*, const char*> &command);
     void        update_coordinates(GCodeLine &gline, std::pair<const char*, const char*> &command);
+    // To be called before a parsed line is passed to the callback.
+    void        reset_relative_e(const GCodeLine &gline) { if (gline.has(E) && m_config.use_relative_e_distances) m_position[E] = 0; }
+
+    // Skips the whitespaces and an optional line number.
+    static const char*  skip_line_number(const char *c) {
+        c = skip_whitespaces(c);
+        if (std::toupper(*c) == 'N')
+            c = skip_whitespaces(skip_word(c));
+        return c;
+    }
+
+    struct ParsedChunk;
 
     static bool         is_whitespace(char c)           { return c == ' ' || c == '\t'; }
     static bool         is_end_of_line(char c)          { return c == '\r' || c == '\n' || c == 0; }
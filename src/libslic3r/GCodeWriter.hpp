@@ -213,6 +213,15 @@ public:
 
     void emit_axis(const char axis, const double v, size_t digits);
 
+    // Format a single value with the same rounding and trailing zeros trimming as emit_axis(),
+    // for the G-code filters editing the values of already generated G-code.
+    static std::string format_value(const double v, size_t digits) {
+        GCodeFormatter formatter;
+        formatter.emit_axis(' ', v, digits);
+        // Skip the space and the axis name.
+        return std::string(formatter.buf + 2, formatter.ptr_err.ptr);
+    }
+
     void emit_xy(const Vec2d &point) {
         this->emit_axis('X', point.x(), XYZF_EXPORT_DIGITS);
         this->emit_axis('Y', point.y(), XYZF_EXPORT_DIGITS);
@@ -22,6 +22,9 @@
 #include <cmath>
 #include <cassert>
 
+#include <tbb/blocked_range.h>
+#include <tbb/parallel_for.h>
+
 static const int overhang_sampling_number = 6;
 static const double narrow_loop_length_threshold = 10;
 //BBS: when the width of expolygon is smaller than
@@ -1931,88 +1934,116 @@ void PerimeterGenerator::process_arachne()
 
     // BBS: don't simplify too much which influence arc fitting when export gcode if arc_fitting is enabled
     double surface_simplify_resolution = (print_config->enable_arc_fitting && this->config->fuzzy_skin == FuzzySkinType::None) ? 0.2 * m_scaled_resolution : m_scaled_resolution;
-    // we need to process each island separately because we might have different
-    // extra perimeters for each one
-    for (const Surface& surface : this->slices->surfaces) {
-        coord_t bead_width_0 = ext_perimeter_spacing;
-        // detect how many perimeters must be generated for this island
-        int        loop_number = this->config->wall_loops + surface.extra_perimeters - 1; // 0-indexed loops
-        if (this->layer_id == 0 && this->config->only_one_wall_first_layer)
-            loop_number = 0;
-        // Orca: set the topmost layer to be one wall according to the config
-        if (loop_number > 0 && config->only_one_wall_top && this->upper_slices == nullptr)
-            loop_number = 0;
-        // Orca: properly adjust offset for the outer wall if precise_outer_wall is enabled.
-        ExPolygons last = offset_ex(surface.expolygon.simplify_p(surface_simplify_resolution),
-                      config->precise_outer_wall ? -float(ext_perimeter_width - ext_perimeter_spacing )
-                                                 : -float(ext_perimeter_width / 2. - ext_perimeter_spacing / 2.));
-        
-        Arachne::WallToolPathsParams input_params = Arachne::make_paths_params(this->layer_id, *object_config, *print_config);
-        coord_t wall_0_inset = 0;
-        if (config->precise_outer_wall)
-           wall_0_inset = -coord_t(ext_perimeter_width / 2 - ext_perimeter_spacing / 2);
-
-        std::vector<Arachne::VariableWidthLines> out_shell;
-        ExPolygons top_fills;
-        ExPolygons fill_clip;
-        if (loop_number > 0 && config->only_one_wall_top && !surface.is_bridge() && this->upper_slices != nullptr) {
-            // Check if current layer has surfaces that are not covered by upper layer (i.e., top surfaces)
-            ExPolygons non_top_polygons;
-            this->split_top_surfaces(last, top_fills, non_top_polygons, fill_clip);
-
-            if (top_fills.empty()) {
-                // No top surfaces, no special handling needed
-            } else {
-                // First we slice the outer shell
-                Polygons last_p = to_polygons(last);
-                Arachne::WallToolPaths wallToolPaths(last_p, bead_width_0, perimeter_spacing, coord_t(1),
-                                                     wall_0_inset, layer_height, input_params);
-                out_shell = wallToolPaths.getToolPaths();
-                // Make sure infill not overlap with wall
-                top_fills = intersection_ex(top_fills, wallToolPaths.getInnerContour());
-
-                if (!top_fills.empty()) {
-                    // Then get the inner part that needs more walls
-                    last = intersection_ex(non_top_polygons, wallToolPaths.getInnerContour());
-                    loop_number--;
+    // Results of the Arachne wall generator for a single island.
+    struct ArachneIsland
+    {
+        int                                         loop_number { 0 };
+#ifdef ARACHNE_DEBUG
+        ExPolygons                                  last;
+#endif
+        ExPolygons                                  top_fills;
+        std::vector<Arachne::VariableWidthLines>    perimeters;
+        Polygons                                    inner_contour;
+    };
+    // Generating the variable width walls is by far the most expensive part, and the islands are independent of each other.
+    // Generate the walls of all islands in parallel, then order and collect the extrusions of the islands one by one.
+    const Surfaces              &surfaces = this->slices->surfaces;
+    std::vector<ArachneIsland>   islands(surfaces.size());
+    const Arachne::WallToolPathsParams input_params = Arachne::make_paths_params(this->layer_id, *object_config, *print_config);
+    tbb::parallel_for(tbb::blocked_range<size_t>(0, surfaces.size()), [&](const tbb::blocked_range<size_t> &range) {
+        for (size_t island_idx = range.begin(); island_idx < range.end(); ++ island_idx) {
+            const Surface &surface = surfaces[island_idx];
+            ArachneIsland &island  = islands[island_idx];
+            coord_t bead_width_0 = ext_perimeter_spacing;
+            // detect how many perimeters must be generated for this island
+            int        loop_number = this->config->wall_loops + surface.extra_perimeters - 1; // 0-indexed loops
+            if (this->layer_id == 0 && this->config->only_one_wall_first_layer)
+                loop_number = 0;
+            // Orca: set the topmost layer to be one wall according to the config
+            if (loop_number > 0 && config->only_one_wall_top && this->upper_slices == nullptr)
+                loop_number = 0;
+            // Orca: properly adjust offset for the outer wall if precise_outer_wall is enabled.
+            ExPolygons last = offset_ex(surface.expolygon.simplify_p(surface_simplify_resolution),
+                          config->precise_outer_wall ? -float(ext_perimeter_width - ext_perimeter_spacing )
+                                                     : -float(ext_perimeter_width / 2. - ext_perimeter_spacing / 2.));
+
+            coord_t wall_0_inset = 0;
+            if (config->precise_outer_wall)
+               wall_0_inset = -coord_t(ext_perimeter_width / 2 - ext_perimeter_spacing / 2);
+
+            std::vector<Arachne::VariableWidthLines> out_shell;
+            ExPolygons &top_fills = island.top_fills;
+            ExPolygons fill_clip;
+            if (loop_number > 0 && config->only_one_wall_top && !surface.is_bridge() && this->upper_slices != nullptr) {
+                // Check if current layer has surfaces that are not covered by upper layer (i.e., top surfaces)
+                ExPolygons non_top_polygons;
+                this->split_top_surfaces(last, top_fills, non_top_polygons, fill_clip);
+
+                if (top_fills.empty()) {
+                    // No top surfaces, no special handling needed
                 } else {
-                    // Give up the outer shell because we don't have any meaningful top surface
-                    out_shell.clear();
+                    // First we slice the outer shell
+                    Polygons last_p = to_polygons(last);
+                    Arachne::WallToolPaths wallToolPaths(last_p, bead_width_0, perimeter_spacing, coord_t(1),
+                                                         wall_0_inset, layer_height, input_params);
+                    out_shell = wallToolPaths.getToolPaths();
+                    // Make sure infill not overlap with wall
+                    top_fills = intersection_ex(top_fills, wallToolPaths.getInnerContour());
+
+                    if (!top_fills.empty()) {
+                        // Then get the inner part that needs more walls
+                        last = intersection_ex(non_top_polygons, wallToolPaths.getInnerContour());
+                        loop_number--;
+                    } else {
+                        // Give up the outer shell because we don't have any meaningful top surface
+                        out_shell.clear();
+                    }
                 }
             }
-        }
 
-        Polygons last_p = to_polygons(last);
+            Polygons last_p = to_polygons(last);
 
-        Arachne::WallToolPaths wallToolPaths(last_p, bead_width_0, perimeter_spacing, coord_t(loop_number + 1),
-                                             wall_0_inset, layer_height, input_params);
+            Arachne::WallToolPaths wallToolPaths(last_p, bead_width_0, perimeter_spacing, coord_t(loop_number + 1),
+                                                 wall_0_inset, layer_height, input_params);
 
-        std::vector<Arachne::VariableWidthLines> perimeters = wallToolPaths.getToolPaths();
+            std::vector<Arachne::VariableWidthLines> &perimeters = island.perimeters;
+            perimeters = wallToolPaths.getToolPaths();
 
-        if (!out_shell.empty()) {
-            // Combine outer shells
-            size_t inset_offset = 0;
-            for (auto &p : out_shell) {
-                for (auto &l : p) {
-                    if (l.inset_idx + 1 > inset_offset) {
-                        inset_offset = l.inset_idx + 1;
+            if (!out_shell.empty()) {
+                // Combine outer shells
+                size_t inset_offset = 0;
+                for (auto &p : out_shell) {
+                    for (auto &l : p) {
+                        if (l.inset_idx + 1 > inset_offset) {
+                            inset_offset = l.inset_idx + 1;
+                        }
                     }
                 }
-            }
-             for (auto &p : perimeters) {
-                 for (auto &l : p) {
-                     l.inset_idx += inset_offset;
+                 for (auto &p : perimeters) {
+                     for (auto &l : p) {
+                         l.inset_idx += inset_offset;
+                     }
                  }
-             }
 
-            perimeters.insert(perimeters.begin(), out_shell.begin(), out_shell.end());
+                perimeters.insert(perimeters.begin(), out_shell.begin(), out_shell.end());
+            }
+            island.loop_number   = int(perimeters.size()) - 1;
+            island.inner_contour = wallToolPaths.getInnerContour();
+#ifdef ARACHNE_DEBUG
+            island.last          = std::move(last);
+#endif
         }
-        loop_number = int(perimeters.size()) - 1;
+    });
+
+    for (ArachneIsland &island : islands) {
+        int                                       loop_number = island.loop_number;
+        const ExPolygons                         &top_fills   = island.top_fills;
+        std::vector<Arachne::VariableWidthLines> &perimeters  = island.perimeters;
 
         #ifdef ARACHNE_DEBUG
         {
             static int iRun = 0;
-            export_perimeters_to_svg(debug_out_path("arachne-perimeters-%d-%d.svg", layer_id, iRun++), to_polygons(last), perimeters, union_ex(wallToolPaths.getInnerContour()));
+            export_perimeters_to_svg(debug_out_path("arachne-perimeters-%d-%d.svg", layer_id, iRun++), to_polygons(island.last), perimeters, union_ex(island.inner_contour));
         }
 #endif
 
@@ -2276,7 +2307,7 @@ void PerimeterGenerator::process_arachne()
             this->loops->append(extrusion_coll);
         }
 
-ExPolygons    infill_contour = union_ex(wallToolPaths.getInnerContour());
+        ExPolygons    infill_contour = union_ex(island.inner_contour);
         const coord_t spacing = (perimeters.size() == 1) ? ext_perimeter_spacing2 : perimeter_spacing;
 
         if (offset_ex(infill_contour, -float(spacing / 2.)).empty())
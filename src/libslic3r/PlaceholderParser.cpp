@@ -1,11 +1,17 @@
 #include "PlaceholderParser.hpp"
 #include "Exception.hpp"
 #include "Flow.hpp"
+#include <algorithm>
 #include <cstring>
 #include <ctime>
+#include <deque>
 #include <iomanip>
 #include <sstream>
 #include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <unordered_map>
 #ifdef _MSC_VER
     #include <stdlib.h>  // provides **_environ
 #else
@@ -1676,23 +1682,25 @@ namespace client
     };
 }
 
-static std::string process_macro(const std::string &templ, client::MyContext &context)
+typedef client::macro_processor<std::string::const_iterator> macro_processor;
+
+// Our grammar, statically allocated, meaning it will be allocated the first time PlaceholderParser::process() runs.
+static const macro_processor& macro_processor_instance()
 {
-    typedef std::string::const_iterator iterator_type;
-    typedef client::macro_processor<iterator_type> macro_processor;
+    static macro_processor instance;
+    return instance;
+}
 
+static std::string process_macro(const std::string &templ, client::MyContext &context)
+{
     // Our whitespace skipper.
     spirit_encoding::space_type space;
-    // Our grammar, statically allocated inside the method, meaning it will be allocated the first time
-    // PlaceholderParser::process() runs.
-    //FIXME this kind of initialization is not thread safe!
-    static macro_processor      macro_processor_instance;
     // Iterators over the source template.
     std::string::const_iterator iter = templ.begin();
     std::string::const_iterator end  = templ.end();
     // Accumulator for the processed template.
     std::string                 output;
-    phrase_parse(iter, end, macro_processor_instance(&context), space, output);
+    phrase_parse(iter, end, macro_processor_instance()(&context), space, output);
 	if (!context.error_message.empty()) {
         if (context.error_message.back() != '\n' && context.error_message.back() != '\r')
             context.error_message += '\n';
@@ -1701,6 +1709,242 @@ static std::string process_macro(const std::string &templ, client::MyContext &co
     return output;
 }
 
+// Run the macro_processor grammar over a part of a template. Returns false on a syntax or runtime error.
+static bool process_macro_segment(const std::string &templ, size_t begin, size_t end, client::MyContext &context, std::string &output)
+{
+    spirit_encoding::space_type space;
+    std::string::const_iterator iter = templ.begin() + begin;
+    std::string::const_iterator last = templ.begin() + end;
+    std::string                 segment_output;
+    bool                        ok   = phrase_parse(iter, last, macro_processor_instance()(&context), space, segment_output);
+    if (! ok || ! context.error_message.empty())
+        return false;
+    output += segment_output;
+    return true;
+}
+
+// A template split into pieces, which are evaluated one after the other: Free text copied verbatim,
+// legacy variable expansions [variable] and [vector_variable[index_variable]] resolved without running the parser,
+// and macros run through the macro_processor grammar one by one.
+// A template, which cannot be split reliably, is a single macro spanning the whole template.
+struct CompiledTemplate
+{
+    enum class SegmentType : unsigned char {
+        Text,
+        LegacyVariable,
+        LegacyVectorVariable,
+        Macro,
+    };
+    struct Segment {
+        SegmentType type;
+        // Range of the text or macro in templ, or range of the variable name of a legacy variable expansion.
+        size_t      begin;
+        size_t      end;
+        // Range of the name of the index variable of a legacy vector variable expansion.
+        size_t      index_begin { 0 };
+        size_t      index_end   { 0 };
+    };
+
+    std::string             templ;
+    std::vector<Segment>    segments;
+};
+
+// Matches utf8_char_skipper_parser: Free text with an invalid UTF-8 sequence is reported as an error by the parser.
+static bool valid_macro_text(const char *begin, const char *end)
+{
+    for (const char *it = begin; it != end;) {
+        unsigned char c = static_cast<unsigned char>(*it ++);
+        if ((c & 0xC0) == 0x80)
+            return false;
+        unsigned int cnt = 0;
+        for (unsigned char mask = 0x80u; c & mask; mask >>= 1)
+            ++ cnt;
+        cnt = (cnt == 0) ? 1 : std::min(cnt, 4u);
+        for (-- cnt; cnt > 0; -- cnt) {
+            if (it == end)
+                return false;
+            c = static_cast<unsigned char>(*it ++);
+            if (cnt > 1 && (c & 0xC0) != 0x80)
+                return false;
+        }
+    }
+    return true;
+}
+
+static CompiledTemplate compile_template(const std::string &templ)
+{
+    using SegmentType = CompiledTemplate::SegmentType;
+    CompiledTemplate out;
+    out.templ = templ;
+
+    auto is_ident_first = [](char c) { return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c == '_'; };
+    auto is_ident       = [&is_ident_first](char c) { return is_ident_first(c) || (c >= '0' && c <= '9'); };
+    auto is_space       = [](char c) { return c == ' ' || c == '\t' || c == '\n' || c == '\r' || c == '\f' || c == '\v'; };
+    // Keywords of the macro_processor grammar, which are not valid identifiers.
+    static const std::set<std::string> keywords { "and", "digits", "zdigits", "if", "int", "is_nil", "else", "elsif", "endif",
+        "false", "interpolate_table", "min", "max", "random", "round", "not", "one_of", "or", "true" };
+    // Position after an identifier starting at pos, pos if there is none.
+    auto identifier_end = [&templ, &is_ident_first, &is_ident](size_t pos) {
+        if (pos < templ.size() && is_ident_first(templ[pos]))
+            for (++ pos; pos < templ.size() && is_ident(templ[pos]); ++ pos) ;
+        return pos;
+    };
+    auto word_after_brace = [&templ, &is_space, &identifier_end](size_t pos) {
+        for (++ pos; pos < templ.size() && is_space(templ[pos]); ++ pos) ;
+        return templ.substr(pos, identifier_end(pos) - pos);
+    };
+    // The grammar skips the white space at the start of the template. Leave an unusual start to the grammar.
+    size_t pos = 0;
+    for (; pos < templ.size() && is_space(templ[pos]); ++ pos) ;
+    bool   ok  = pos == templ.size() || static_cast<unsigned char>(templ[pos]) < 0x80;
+
+    while (ok && pos < templ.size()) {
+        size_t next = templ.find_first_of("[{", pos);
+        if (next == std::string::npos)
+            next = templ.size();
+        if (next > pos) {
+            if (! (ok = valid_macro_text(templ.data() + pos, templ.data() + next)))
+                break;
+            out.segments.push_back({ SegmentType::Text, pos, next });
+            pos = next;
+            continue;
+        }
+        if (templ[pos] == '[') {
+            // Only the compact forms without white space are resolved directly, anything else is left to the grammar.
+            size_t name_end = identifier_end(pos + 1);
+            if (name_end == pos + 1 || name_end == templ.size() || keywords.count(templ.substr(pos + 1, name_end - pos - 1))) {
+                ok = false;
+            } else if (templ[name_end] == ']') {
+                out.segments.push_back({ SegmentType::LegacyVariable, pos + 1, name_end });
+                pos = name_end + 1;
+            } else if (templ[name_end] == '[') {
+                size_t index_end = identifier_end(name_end + 1);
+                if (index_end == name_end + 1 || templ.compare(index_end, 2, "]]") != 0 ||
+                    keywords.count(templ.substr(name_end + 1, index_end - name_end - 1)))
+                    ok = false;
+                else {
+                    out.segments.push_back({ SegmentType::LegacyVectorVariable, pos + 1, name_end, name_end + 1, index_end });
+                    pos = index_end + 2;
+                }
+            } else
+                ok = false;
+        } else {
+            const std::string word = word_after_brace(pos);
+            size_t            end  = std::string::npos;
+            if (word == "if") {
+                // Find the matching {endif}.
+                int depth = 0;
+                for (size_t brace = pos; brace != std::string::npos; brace = templ.find('{', brace + 1)) {
+                    const std::string w = word_after_brace(brace);
+                    if (w == "if")
+                        ++ depth;
+                    else if (w == "endif" && -- depth == 0) {
+                        end = templ.find('}', brace);
+                        break;
+                    }
+                }
+            } else if (word != "elsif" && word != "else" && word != "endif") {
+                // Find the matching closing brace.
+                int depth = 0;
+                for (size_t i = pos; i < templ.size(); ++ i)
+                    if (templ[i] == '{')
+                        ++ depth;
+                    else if (templ[i] == '}' && -- depth == 0) {
+                        end = i;
+                        break;
+                    }
+            }
+            // Braces inside string literals and regular expressions would confuse the search above. A regular expression
+            // cannot be told from a division without parsing, thus any slash leaves the template to the grammar.
+            if (end == std::string::npos || templ.find_first_of("\"/", pos) < end)
+                ok = false;
+            else {
+                out.segments.push_back({ SegmentType::Macro, pos, end + 1 });
+                pos = end + 1;
+            }
+        }
+    }
+
+    if (! ok)
+        out.segments = { { SegmentType::Macro, 0, templ.size() } };
+    return out;
+}
+
+// Templates are compiled once and shared by all the PlaceholderParser instances, as the same custom G-code blocks
+// are expanded at every layer change and tool change.
+class CompiledTemplateCache
+{
+public:
+    static CompiledTemplateCache& instance() { static CompiledTemplateCache cache; return cache; }
+
+    std::shared_ptr<const CompiledTemplate> get(const std::string &templ)
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if (auto it = m_map.find(templ); it != m_map.end())
+                return it->second;
+        }
+        // Compile outside of the lock. Two threads may compile the same template, the first one is kept.
+        auto compiled = std::make_shared<const CompiledTemplate>(compile_template(templ));
+        std::lock_guard<std::mutex> lock(m_mutex);
+        auto [it, inserted] = m_map.emplace(templ, compiled);
+        if (inserted) {
+            m_fifo.emplace_back(&it->first);
+            if (m_fifo.size() > MAX_ENTRIES) {
+                m_map.erase(*m_fifo.front());
+                m_fifo.pop_front();
+            }
+        }
+        return it->second;
+    }
+
+private:
+    // Enough for all the custom G-code blocks of the printer, filament and process presets and of the model.
+    static constexpr const size_t MAX_ENTRIES = 512;
+
+    std::mutex                                                                  m_mutex;
+    std::unordered_map<std::string, std::shared_ptr<const CompiledTemplate>>    m_map;
+    // Keys of m_map in the order of insertion. References to the keys of an unordered_map remain valid until the key is erased.
+    std::deque<const std::string*>                                              m_fifo;
+};
+
+// Evaluate the segments of a compiled template. Returns false on a syntax or runtime error.
+static bool process_compiled(const CompiledTemplate &compiled, client::MyContext &context, std::string &output)
+{
+    using SegmentType = CompiledTemplate::SegmentType;
+    using Iterator    = std::string::const_iterator;
+    const std::string &templ = compiled.templ;
+    auto range = [&templ](size_t begin, size_t end) { return boost::iterator_range<Iterator>(templ.begin() + begin, templ.begin() + end); };
+    std::string value;
+    for (const CompiledTemplate::Segment &segment : compiled.segments) {
+        switch (segment.type) {
+        case SegmentType::Text:
+            output.append(templ, segment.begin, segment.end - segment.begin);
+            break;
+        case SegmentType::LegacyVariable:
+        case SegmentType::LegacyVectorVariable:
+            try {
+                boost::iterator_range<Iterator> opt_key = range(segment.begin, segment.end);
+                if (segment.type == SegmentType::LegacyVariable)
+                    client::MyContext::legacy_variable_expansion<Iterator>(&context, opt_key, value);
+                else {
+                    boost::iterator_range<Iterator> opt_index = range(segment.index_begin, segment.index_end);
+                    client::MyContext::legacy_variable_expansion2<Iterator>(&context, opt_key, opt_index, value);
+                }
+            } catch (const qi::expectation_failure<Iterator> &) {
+                return false;
+            }
+            output += value;
+            break;
+        case SegmentType::Macro:
+            if (! process_macro_segment(templ, segment.begin, segment.end, context, output))
+                return false;
+            break;
+        }
+    }
+    return true;
+}
+
 std::string PlaceholderParser::process(const std::string &templ, unsigned int current_extruder_id, const DynamicConfig *config_override, DynamicConfig *config_outputs, ContextData *context_data) const
 {
     client::MyContext context;
@@ -1710,6 +1954,14 @@ std::string PlaceholderParser::process(const std::string &templ, unsigned int cu
     context.config_outputs      = config_outputs;
     context.current_extruder_id = current_extruder_id;
     context.context_data        = context_data;
+    std::shared_ptr<const CompiledTemplate> compiled = CompiledTemplateCache::instance().get(templ);
+    std::string                             output;
+    if (process_compiled(*compiled, context, output))
+        return output;
+    // The segments are the top level blocks of the grammar, thus a compiled template fails exactly if the whole template fails.
+    // Process the whole template again to report the error with the line numbers counted from the start of the template.
+    // Assignments preceding the error are evaluated again before the error is thrown.
+    context.error_message.clear();
     return process_macro(templ, context);
 }
 
@@ -1,6 +1,7 @@
 #include <cassert>
 
 #include "PresetBundle.hpp"
+#include "PresetIndex.hpp"
 #include "libslic3r.h"
 #include "Utils.hpp"
 #include "Model.hpp"
@@ -12,6 +13,7 @@
 #include <unordered_set>
 #include <boost/filesystem.hpp>
 #include <boost/algorithm/clamp.hpp>
+#include <boost/functional/hash.hpp>
 #include <boost/algorithm/string/predicate.hpp>
 #include <boost/range/adaptor/transformed.hpp>
 #include <boost/nowide/cenv.hpp>
@@ -3108,6 +3110,72 @@ void PresetBundle::load_config_file_config(const std::string &name_or_path, bool
     return std::make_pair(std::move(substitutions), presets_loaded + ph_printers_loaded);
 }*/
 
+// Hash of everything the resolved system presets of a vendor depend on: The content of the vendor's JSON files
+// and the default presets, which the indexed presets are stored relative to.
+static uint64_t vendor_index_hash(PresetBundle &bundle, const std::string &root_file, const std::string &vendor_dir,
+    std::initializer_list<const std::vector<std::pair<std::string, std::string>>*> subfile_lists)
+{
+    size_t seed = 0;
+    boost::hash_combine(seed, PresetIndex::FORMAT_VERSION);
+    boost::hash_combine(seed, std::string(SLIC3R_VERSION));
+    for (PresetCollection *presets : { &bundle.prints, &bundle.filaments, static_cast<PresetCollection*>(&bundle.printers) })
+        for (size_t i = 0; i < presets->num_default_presets(); ++ i)
+            PresetIndex::hash_config(seed, presets->default_preset(i).config);
+    std::vector<std::string> files { root_file };
+    for (const std::vector<std::pair<std::string, std::string>> *subfiles : subfile_lists) {
+        boost::hash_combine(seed, subfiles->size());
+        for (const std::pair<std::string, std::string> &subfile : *subfiles) {
+            boost::hash_combine(seed, subfile.first);
+            files.emplace_back(vendor_dir + subfile.second);
+        }
+    }
+    PresetIndex::hash_files(seed, files);
+    return uint64_t(seed);
+}
+
+// Load the system presets of a vendor from its index. All the presets are decoded before any of them is added,
+// so that a corrupted or outdated index leaves the bundle untouched and the vendor may be loaded from JSON instead.
+static size_t load_vendor_presets_from_index(PresetBundle &bundle, const PresetIndex::Reader &index, const std::string &vendor_name,
+    PresetBundle::LoadConfigBundleAttributes flags, const VendorProfile *vendor_profile)
+{
+    auto collection_of = [&bundle](Preset::Type type) -> PresetCollection* {
+        switch (type) {
+        case Preset::TYPE_PRINT:    return &bundle.prints;
+        case Preset::TYPE_FILAMENT: return &bundle.filaments;
+        case Preset::TYPE_PRINTER:  return &bundle.printers;
+        default:                    return nullptr;
+        }
+    };
+
+    std::vector<std::pair<PresetIndex::Entry, DynamicPrintConfig>> presets;
+    presets.reserve(index.size());
+    for (size_t i = 0; i < index.size(); ++ i) {
+        if (flags.has(PresetBundle::LoadConfigBundleAttribute::LoadFilamentOnly) && index.type(i) != Preset::TYPE_FILAMENT)
+            continue;
+        PresetIndex::Entry entry      = index.entry(i);
+        PresetCollection  *collection = collection_of(entry.type);
+        if (collection == nullptr || entry.default_idx >= collection->num_default_presets())
+            throw Slic3r::FileIOError("Invalid preset " + entry.name + " in the preset index of vendor " + vendor_name);
+        DynamicPrintConfig config = collection->default_preset(entry.default_idx).config;
+        PresetIndex::apply_options(entry.options, config);
+        presets.emplace_back(std::move(entry), std::move(config));
+    }
+
+    for (std::pair<PresetIndex::Entry, DynamicPrintConfig> &preset : presets) {
+        PresetIndex::Entry &entry     = preset.first;
+        auto                file_path = (boost::filesystem::path(data_dir()) / PRESET_SYSTEM_DIR / vendor_name / entry.subpath).make_preferred();
+        Preset             &loaded    = collection_of(entry.type)->load_preset(file_path.string(), entry.name, std::move(preset.second), false);
+        loaded.is_system    = true;
+        loaded.vendor       = vendor_profile;
+        loaded.version      = vendor_profile->config_version;
+        loaded.setting_id   = std::move(entry.setting_id);
+        loaded.filament_id  = std::move(entry.filament_id);
+        loaded.alias        = std::move(entry.alias);
+        loaded.renamed_from = std::move(entry.renamed_from);
+    }
+    return presets.size();
+}
+
 //BBS: Load a config bundle file from json
 std::pair<PresetsConfigSubstitutions, size_t> PresetBundle::load_vendor_configs_from_json(
     const std::string &path, const std::string &vendor_name, LoadConfigBundleAttributes flags, ForwardCompatibilitySubstitutionRule compatibility_rule)
@@ -3210,6 +3278,15 @@ std::pair<PresetsConfigSubstitutions, size_t> PresetBundle::load_vendor_configs_
         //goto __error_process;
     }
 
+    // System presets are loaded from an index of the resolved presets compiled at the previous load, if the JSON files did not change.
+    std::string index_path;
+    uint64_t    index_hash = 0;
+    if (flags.has(LoadConfigBundleAttribute::LoadSystem) && ! flags.has(LoadConfigBundleAttribute::LoadVendorOnly)) {
+        index_path = PresetIndex::index_path(path, vendor_name);
+        index_hash = vendor_index_hash(*this, root_file, path + "/" + vendor_name + "/",
+            { &machine_model_subfiles, &process_subfiles, &filament_subfiles, &machine_subfiles });
+    }
+
     if (flags.has(LoadConfigBundleAttribute::LoadFilamentOnly)) {
         machine_model_subfiles.clear();
         machine_subfiles.clear();
@@ -3310,11 +3387,27 @@ std::pair<PresetsConfigSubstitutions, size_t> PresetBundle::load_vendor_configs_
     if (flags.has(LoadConfigBundleAttribute::LoadVendorOnly))
         return std::make_pair(PresetsConfigSubstitutions{}, 0);
 
+    if (! index_path.empty() && boost::filesystem::exists(index_path)) {
+        try {
+            PresetIndex::Reader index(index_path);
+            if (index.hash() == index_hash) {
+                size_t presets_loaded = load_vendor_presets_from_index(*this, index, vendor_name, flags, current_vendor_profile);
+                BOOST_LOG_TRIVIAL(debug) << __FUNCTION__ << boost::format(", finished, presets_loaded %1% from index %2%")%presets_loaded %index_path;
+                return std::make_pair(PresetsConfigSubstitutions{}, presets_loaded);
+            }
+        } catch (const std::exception &err) {
+            BOOST_LOG_TRIVIAL(warning) << __FUNCTION__ << boost::format(", failed loading preset index %1%: %2%")%index_path %err.what();
+        }
+    }
+
     // 3) paste the process/filament/print configs
     PresetCollection         *presets = nullptr;
     size_t                   presets_loaded = 0;
+    // The index is compiled from a complete load of the vendor's presets only.
+    bool                            compile_index = ! index_path.empty() && ! flags.has(LoadConfigBundleAttribute::LoadFilamentOnly);
+    std::vector<PresetIndex::Entry> index_entries;
 
-    auto parse_subfile = [path, vendor_name, presets_loaded, current_vendor_profile](\
+    auto parse_subfile = [path, vendor_name, presets_loaded, current_vendor_profile, &compile_index, &index_entries](\
         ConfigSubstitutionContext& substitution_context,
         PresetsConfigSubstitutions& substitutions,
         LoadConfigBundleAttributes& flags,
@@ -3490,6 +3583,25 @@ std::pair<PresetsConfigSubstitutions, size_t> PresetBundle::load_vendor_configs_
             substitutions.push_back({
                 preset_name, presets_collection->type(), PresetConfigSubstitutions::Source::ConfigBundle,
                 std::string(), std::move(substitution_context.substitutions) });
+        if (compile_index) {
+            const Preset       &defaults = presets_collection->default_preset_for(loaded.config);
+            PresetIndex::Entry  entry;
+            entry.type = presets_collection->type();
+            while (&presets_collection->default_preset(entry.default_idx) != &defaults)
+                ++ entry.default_idx;
+            if (PresetIndex::diff_options(loaded.config, defaults.config, entry.options)) {
+                entry.name         = loaded.name;
+                entry.subpath      = subfile_iter.second;
+                entry.setting_id   = loaded.setting_id;
+                entry.filament_id  = loaded.filament_id;
+                entry.alias        = loaded.alias;
+                entry.renamed_from = loaded.renamed_from;
+                index_entries.emplace_back(std::move(entry));
+            } else {
+                BOOST_LOG_TRIVIAL(warning) << __FUNCTION__ << boost::format(": preset %1% cannot be stored into the preset index exactly, the index will not be created")%preset_name;
+                compile_index = false;
+            }
+        }
         config_maps.emplace(preset_name, loaded.config);
         ++count;
         //BBS: add config related logs
@@ -3544,6 +3656,15 @@ std::pair<PresetsConfigSubstitutions, size_t> PresetBundle::load_vendor_configs_
         }
     }
 
+    // Presets with substituted values are not indexed, so that the substitutions are reported on each load.
+    if (compile_index && substitutions.empty()) {
+        try {
+            PresetIndex::save(index_path, index_hash, index_entries);
+        } catch (const std::exception &err) {
+            BOOST_LOG_TRIVIAL(warning) << __FUNCTION__ << boost::format(", failed saving preset index %1%: %2%")%index_path %err.what();
+        }
+    }
+
     //BBS: add config related logs
     BOOST_LOG_TRIVIAL(debug) << __FUNCTION__ << boost::format(", finished, presets_loaded %1%")%presets_loaded;
     return std::make_pair(std::move(substitutions), presets_loaded);
@@ -0,0 +1,240 @@
+#include "PresetIndex.hpp"
+
+#include "Exception.hpp"
+#include "Format/BinaryCodec.hpp"
+#include "PrintConfig.hpp"
+#include "Utils.hpp"
+
+#include <cstring>
+#include <memory>
+#include <type_traits>
+
+#include <boost/filesystem.hpp>
+#include <boost/format.hpp>
+#include <boost/functional/hash.hpp>
+#include <boost/nowide/fstream.hpp>
+
+namespace Slic3r {
+namespace PresetIndex {
+
+static constexpr const char     MAGIC[8]        = { 'O', 'R', 'C', 'A', 'P', 'I', 'D', 'X' };
+// Written in the native byte order, used to reject indices written on a machine with a different byte order.
+static constexpr const uint32_t BYTE_ORDER_MARK = 0x01020304;
+
+// Fixed size part of the file, followed by the table of preset types and the offset table.
+struct FileHeader
+{
+    char        magic[8];
+    uint32_t    version;
+    uint32_t    byte_order_mark;
+    uint64_t    hash;
+    uint64_t    num_entries;
+};
+static_assert(std::is_trivially_copyable<FileHeader>::value, "FileHeader is written as is");
+
+std::string index_path(const std::string &path, const std::string &vendor_name)
+{
+    // The same vendor may be loaded from the data directory and from the resources, keep their indices apart.
+    const std::string file_name = (boost::format("%1%.%2$016x.idx") % vendor_name % uint64_t(boost::hash<std::string>{}(path))).str();
+    return (boost::filesystem::path(data_dir()) / "cache" / "profiles" / file_name).make_preferred().string();
+}
+
+void hash_files(size_t &seed, const std::vector<std::string> &files)
+{
+    std::string data;
+    for (const std::string &file : files) {
+        boost::hash_combine(seed, file);
+        data.clear();
+        boost::nowide::ifstream ifs(file, std::ios::in | std::ios::binary);
+        if (ifs) {
+            ifs.seekg(0, std::ios::end);
+            data.resize(size_t(ifs.tellg()));
+            ifs.seekg(0, std::ios::beg);
+            ifs.read(&data[0], data.size());
+            if (! ifs)
+                data.clear();
+        }
+        boost::hash_combine(seed, data.size());
+        // Hash in machine words, the profiles are tens of megabytes.
+        const size_t num_words = data.size() / sizeof(uint64_t);
+        for (size_t i = 0; i < num_words; ++ i) {
+            uint64_t word;
+            ::memcpy(&word, data.data() + i * sizeof(uint64_t), sizeof(uint64_t));
+            boost::hash_combine(seed, word);
+        }
+        for (size_t i = num_words * sizeof(uint64_t); i < data.size(); ++ i)
+            boost::hash_combine(seed, data[i]);
+    }
+}
+
+void hash_config(size_t &seed, const DynamicPrintConfig &config)
+{
+    for (const std::string &key : config.keys()) {
+        boost::hash_combine(seed, key);
+        boost::hash_combine(seed, config.option(key)->hash());
+    }
+}
+
+bool diff_options(const DynamicPrintConfig &config, const DynamicPrintConfig &defaults, Options &out)
+{
+    out.clear();
+    for (const std::string &key : config.keys()) {
+        const ConfigOption *opt     = config.option(key);
+        const ConfigOption *opt_def = defaults.option(key);
+        if (opt_def != nullptr && *opt == *opt_def)
+            continue;
+        std::string value = opt->serialize();
+        // Floating point values are serialized with a limited precision, make sure that the value is restored exactly.
+        std::unique_ptr<ConfigOption> restored(opt->clone());
+        if (! restored->deserialize(value) || ! (*restored == *opt))
+            return false;
+        out.emplace_back(key, std::move(value));
+    }
+    return true;
+}
+
+void apply_options(const Options &options, DynamicPrintConfig &config)
+{
+    for (const std::pair<std::string, std::string> &kvp : options)
+        config.set_deserialize_strict(kvp.first, kvp.second);
+}
+
+// Appends the preset records to a buffer.
+class Encoder : public BinaryEncoder
+{
+public:
+    void entry(const Entry &entry)
+    {
+        this->pod(entry.default_idx);
+        this->string(entry.name);
+        this->string(entry.subpath);
+        this->string(entry.setting_id);
+        this->string(entry.filament_id);
+        this->string(entry.alias);
+        this->count(entry.renamed_from.size());
+        for (const std::string &name : entry.renamed_from)
+            this->string(name);
+        this->count(entry.options.size());
+        for (const std::pair<std::string, std::string> &kvp : entry.options) {
+            this->string(kvp.first);
+            this->string(kvp.second);
+        }
+    }
+};
+
+// Reads the preset records from a memory mapped file, throws if a record is shorter than expected.
+class Decoder : public BinaryDecoder
+{
+public:
+    Decoder(const char *begin, const char *end, const std::string &path) : BinaryDecoder(begin, end, "Preset index", path) {}
+
+    Entry entry()
+    {
+        Entry out;
+        out.default_idx = this->pod<uint32_t>();
+        out.name        = this->string();
+        out.subpath     = this->string();
+        out.setting_id  = this->string();
+        out.filament_id = this->string();
+        out.alias       = this->string();
+        out.renamed_from.resize(this->count());
+        for (std::string &name : out.renamed_from)
+            name = this->string();
+        out.options.resize(this->count());
+        for (std::pair<std::string, std::string> &kvp : out.options) {
+            kvp.first  = this->string();
+            kvp.second = this->string();
+        }
+        return out;
+    }
+};
+
+void save(const std::string &path, uint64_t hash, const std::vector<Entry> &entries)
+{
+    std::vector<int32_t>  types;
+    std::vector<uint64_t> offsets;
+    std::string           records;
+    types.reserve(entries.size());
+    offsets.reserve(entries.size() + 1);
+    offsets.emplace_back(sizeof(FileHeader) + entries.size() * sizeof(int32_t) + (entries.size() + 1) * sizeof(uint64_t));
+    for (const Entry &entry : entries) {
+        Encoder encoder;
+        encoder.entry(entry);
+        types.emplace_back(int32_t(entry.type));
+        records += encoder.data;
+        offsets.emplace_back(offsets.front() + records.size());
+    }
+
+    FileHeader header;
+    ::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    header.version         = FORMAT_VERSION;
+    header.byte_order_mark = BYTE_ORDER_MARK;
+    header.hash            = hash;
+    header.num_entries     = entries.size();
+
+    boost::system::error_code ec;
+    boost::filesystem::create_directories(boost::filesystem::path(path).parent_path(), ec);
+    // Write to a temporary file first, so that a concurrently starting instance never maps a partially written index.
+    const std::string path_tmp = path + ".tmp";
+    {
+        boost::nowide::ofstream out(path_tmp, std::ios::out | std::ios::trunc | std::ios::binary);
+        if (! out)
+            throw Slic3r::FileIOError((boost::format("Cannot create preset index %1%") % path_tmp).str());
+        out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        out.write(reinterpret_cast<const char*>(types.data()), types.size() * sizeof(int32_t));
+        out.write(reinterpret_cast<const char*>(offsets.data()), offsets.size() * sizeof(uint64_t));
+        out.write(records.data(), records.size());
+        out.close();
+        if (! out)
+            throw Slic3r::FileIOError((boost::format("Failed writing preset index %1%") % path_tmp).str());
+    }
+    boost::filesystem::rename(path_tmp, path, ec);
+    if (ec)
+        throw Slic3r::FileIOError((boost::format("Failed renaming preset index %1% to %2%: %3%") % path_tmp % path % ec.message()).str());
+}
+
+Reader::Reader(const std::string &path) : m_path(path)
+{
+    try {
+        m_file.open(path);
+    } catch (const std::exception &ex) {
+        throw Slic3r::FileIOError((boost::format("Cannot open preset index %1%: %2%") % path % ex.what()).str());
+    }
+
+    Decoder decoder(m_file.data(), m_file.data() + m_file.size(), m_path);
+    const FileHeader header = decoder.pod<FileHeader>();
+    if (::memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0 || header.byte_order_mark != BYTE_ORDER_MARK)
+        throw Slic3r::FileIOError((boost::format("%1% is not a preset index") % path).str());
+    if (header.version != FORMAT_VERSION)
+        throw Slic3r::FileIOError((boost::format("Preset index %1% has an incompatible version %2%") % path % header.version).str());
+    if (header.num_entries > m_file.size())
+        decoder.throw_corrupted();
+
+    m_hash = header.hash;
+    m_types.reserve(size_t(header.num_entries));
+    for (size_t i = 0; i < size_t(header.num_entries); ++ i) {
+        int32_t type = decoder.pod<int32_t>();
+        if (type <= int32_t(Preset::TYPE_INVALID) || type >= int32_t(Preset::TYPE_COUNT))
+            decoder.throw_corrupted();
+        m_types.emplace_back(Preset::Type(type));
+    }
+    m_offsets.resize(size_t(header.num_entries) + 1);
+    for (uint64_t &offset : m_offsets)
+        offset = decoder.pod<uint64_t>();
+    for (size_t i = 1; i < m_offsets.size(); ++ i)
+        if (m_offsets[i] < m_offsets[i - 1])
+            decoder.throw_corrupted();
+    if (m_offsets.back() != m_file.size())
+        decoder.throw_corrupted();
+}
+
+Entry Reader::entry(size_t idx) const
+{
+    assert(idx < this->size());
+    Entry out = Decoder(m_file.data() + m_offsets[idx], m_file.data() + m_offsets[idx + 1], m_path).entry();
+    out.type = m_types[idx];
+    return out;
+}
+
+} // namespace PresetIndex
+} // namespace Slic3r
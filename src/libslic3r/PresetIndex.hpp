@@ -0,0 +1,93 @@
+#ifndef slic3r_PresetIndex_hpp_
+#define slic3r_PresetIndex_hpp_
+
+// Binary index of the system presets of a vendor bundle, compiled on the first load of the bundle's JSON files.
+//
+// Loading a vendor bundle from JSON parses every process, filament and machine file and resolves the inheritance
+// chains, which dominates the startup time with the full set of system profiles. The index stores the resolved presets
+// as the options, which differ from the default preset of their collection, so that the next start only deserializes
+// these values. The header stores a hash of the content of all the JSON files of the bundle and of the default presets,
+// so that an index of modified profiles or of another build is rejected and the bundle is loaded from JSON again.
+// There is one index file per vendor, thus only the indices of the vendors being loaded are ever touched.
+
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <boost/iostreams/device/mapped_file.hpp>
+
+#include "Preset.hpp"
+
+namespace Slic3r {
+
+class DynamicPrintConfig;
+
+namespace PresetIndex {
+
+// Increase whenever the layout of the file changes.
+static constexpr const uint32_t FORMAT_VERSION = 1;
+
+using Options = std::vector<std::pair<std::string, std::string>>;
+
+// A system preset after its inheritance has been resolved.
+struct Entry
+{
+    Preset::Type                type            { Preset::TYPE_INVALID };
+    // Index of the default preset of the collection, which the options are relative to.
+    uint32_t                    default_idx     { 0 };
+    std::string                 name;
+    // Path of the JSON file the preset was loaded from, relative to the vendor directory.
+    std::string                 subpath;
+    std::string                 setting_id;
+    std::string                 filament_id;
+    std::string                 alias;
+    std::vector<std::string>    renamed_from;
+    // Serialized options, which differ from the default preset.
+    Options                     options;
+};
+
+// Location of the index of the vendor bundle path/vendor_name.json inside the data directory.
+std::string index_path(const std::string &path, const std::string &vendor_name);
+
+// Combine the hash of the content of files into seed. A missing file hashes as an empty one.
+void hash_files(size_t &seed, const std::vector<std::string> &files);
+// Combine the hash of the keys and values of a config into seed.
+void hash_config(size_t &seed, const DynamicPrintConfig &config);
+
+// Serialize the options of config, which differ from defaults.
+// Returns false if an option does not deserialize to the same value, in that case the preset cannot be indexed.
+bool diff_options(const DynamicPrintConfig &config, const DynamicPrintConfig &defaults, Options &out);
+// Deserialize the options over config. Throws if an option is unknown or its value is invalid.
+void apply_options(const Options &options, DynamicPrintConfig &config);
+
+// Throws Slic3r::FileIOError on failure.
+void save(const std::string &path, uint64_t hash, const std::vector<Entry> &entries);
+
+class Reader
+{
+public:
+    // Map the file into memory and validate its header and the offset table.
+    // Throws Slic3r::FileIOError if the file cannot be opened or if it is not a valid index of the current format version.
+    explicit Reader(const std::string &path);
+
+    uint64_t        hash()              const { return m_hash; }
+    size_t          size()              const { return m_types.size(); }
+    Preset::Type    type(size_t idx)    const { return m_types[idx]; }
+    // Decode a single preset. Throws Slic3r::FileIOError if the record is corrupted.
+    Entry           entry(size_t idx)   const;
+
+private:
+    std::string                             m_path;
+    boost::iostreams::mapped_file_source    m_file;
+    uint64_t                                m_hash { 0 };
+    // Types of the presets, so that the presets of a single collection may be decoded without touching the others.
+    std::vector<Preset::Type>               m_types;
+    // Offsets of the preset records and the end of the file.
+    std::vector<uint64_t>                   m_offsets;
+};
+
+} // namespace PresetIndex
+} // namespace Slic3r
+
+#endif /* slic3r_PresetIndex_hpp_ */
@@ -22,7 +22,10 @@
 #include <Eigen/Geometry>
 
 #include <functional>
+#include <memory>
+#include <mutex>
 #include <set>
+#include <unordered_map>
 
 #include "calib.hpp"
 
@@ -430,6 +433,11 @@ public:
     std::vector<Point> get_instances_shift_without_plate_offset();
     PrintObject* get_shared_object() const { return m_shared_object; }
     void         set_shared_object(PrintObject *object);
+    // Hash of the transformation, the meshes, configs and paint-on data of the volumes and of the object config,
+    // which decide whether two objects may share their slices. Objects with different keys never share their slices,
+    // equal keys have to be confirmed by can_share_slices_with() as the hash may collide.
+    size_t       shared_object_key() const;
+    bool         can_share_slices_with(const PrintObject &other) const;
     void         clear_shared_object();
     void         copy_layers_from_shared_object();
     void         copy_layers_overhang_from_shared_object();
@@ -460,8 +468,16 @@ public:
     bool                    invalidate_all_steps();
     // Invalidate steps based on a set of parameters changed.
     // It may be called for both the PrintObjectConfig and PrintRegionConfig.
+    // If region is not null, the options of just that PrintRegion changed, and the per layer steps (posPerimeters, posInfill)
+    // are invalidated only for the layers, where the region is printed.
     bool                    invalidate_state_by_config_options(
-        const ConfigOptionResolver &old_config, const ConfigOptionResolver &new_config, const std::vector<t_config_option_key> &opt_keys);
+        const ConfigOptionResolver &old_config, const ConfigOptionResolver &new_config, const std::vector<t_config_option_key> &opt_keys,
+        const PrintRegion *region = nullptr);
+    // Invalidates posPerimeters or posInfill just for the layers where the region is printed, other steps and their dependencies
+    // are invalidated completely. Layers invalidated by preceding calls and not regenerated yet are kept invalidated.
+    bool                    invalidate_step_for_layers(PrintObjectStep step, const PrintRegion &region);
+    // Span of print_z of the layers, where the region has some slices. Empty span (first > second) if the region is not printed at all.
+    std::pair<coordf_t, coordf_t> region_z_span(const PrintRegion &region) const;
     // If ! m_slicing_params.valid, recalculate.
     void                    update_slicing_parameters();
 
@@ -526,6 +542,21 @@ private:
     // so that next call to make_perimeters() performs a union() before computing loops
     bool                    				m_typed_slices = false;
 
+    // Layers to be regenerated by a step, which was invalidated just for some of the layers by invalidate_step_for_layers().
+    // Only valid while the step is not done, any complete invalidation of the step resets it to all layers.
+    struct DirtyLayers {
+        bool        all   { true };
+        coordf_t    min_z { 0. };
+        coordf_t    max_z { 0. };
+
+        bool        contains(coordf_t print_z) const { return this->all || (print_z > this->min_z - EPSILON && print_z < this->max_z + EPSILON); }
+        void        reset() { this->all = true; }
+    };
+    // Dirty layers of posPerimeters.
+    DirtyLayers                             m_perimeters_dirty;
+    // Dirty layers of posInfill, which are shared by posIroning and posSimplifyInfill, as both of them post-process the infill.
+    DirtyLayers                             m_infill_dirty;
+
     std::pair<FillAdaptive::OctreePtr, FillAdaptive::OctreePtr> m_adaptive_fill_octrees;
     FillLightning::GeneratorPtr m_lightning_generator;
 
@@ -783,6 +814,40 @@ class ConstPrintRegionPtrsAdaptor : public ConstVectorOfPtrsAdaptor<PrintRegion>
 };
 */
 
+// Slices of the meshes referenced by several model volumes of a Print, for example a modifier or a hardware part
+// repeated in several objects. The volumes, which differ in their transformation by a translation in XY only,
+// share the slices, thus the mesh is sliced once. Filled concurrently by the objects being sliced during Print::process().
+class VolumeSlicesCache
+{
+public:
+    using Slices = std::shared_ptr<const std::vector<ExPolygons>>;
+
+    // Clear the cache and collect the meshes referenced by more than one model volume of the objects to be sliced.
+    void    reset(const std::vector<PrintObject*> &objects);
+    void    clear();
+    // Only the slices of the shared meshes are worth keeping.
+    bool    is_shared(const TriangleMesh *mesh) const { return m_shared_meshes.find(mesh) != m_shared_meshes.end(); }
+    // Slices of mesh sliced at zs with params, calling slice_fn if they are not cached yet.
+    Slices  get(const TriangleMesh *mesh, const std::vector<float> &zs, const MeshSlicingParamsEx &params,
+                const std::function<std::vector<ExPolygons>()> &slice_fn);
+
+private:
+    struct Key {
+        const TriangleMesh  *mesh;
+        std::vector<float>   zs;
+        MeshSlicingParamsEx  params;
+        bool operator==(const Key &rhs) const;
+    };
+    struct KeyHash {
+        size_t operator()(const Key &key) const;
+    };
+
+    // Not modified while slicing, thus not guarded by m_mutex.
+    std::set<const TriangleMesh*>               m_shared_meshes;
+    std::mutex                                  m_mutex;
+    std::unordered_map<Key, Slices, KeyHash>    m_map;
+};
+
 enum FilamentTempType {
     HighTemp=0,
     LowTemp,
@@ -1010,6 +1075,9 @@ private:
     //SoftFever: calibration
     Calib_Params m_calib_params;
 
+    // Slices of the meshes shared by several volumes, valid during Print::process().
+    mutable VolumeSlicesCache               m_volume_slices_cache;
+
     // To allow GCode to set the Print's GCodeExport step status.
     friend class GCode;
     // Allow PrintObject to access m_mutex and m_cancel_callback.
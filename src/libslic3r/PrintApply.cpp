@@ -220,10 +220,14 @@ static t_config_option_keys print_config_diffs(
     const std::vector<std::string> &extruder_retract_keys = print_config_def.extruder_retract_keys();
     const std::string               filament_prefix       = "filament_";
     t_config_option_keys            print_diff;
-    for (const t_config_option_key &opt_key : current_config.keys()) {
+    // Keys of both configs are sorted, walk new_full_config in parallel instead of looking up each key.
+    auto                            it_new                = new_full_config.cbegin();
+    for (const t_config_option_key &opt_key : current_config.keys_ref()) {
         const ConfigOption *opt_old = current_config.option(opt_key);
         assert(opt_old != nullptr);
-        const ConfigOption *opt_new = new_full_config.option(opt_key);
+        while (it_new != new_full_config.cend() && it_new->first < opt_key)
+            ++ it_new;
+        const ConfigOption *opt_new = it_new != new_full_config.cend() && it_new->first == opt_key ? it_new->second.get() : nullptr;
         // assert(opt_new != nullptr);
         if (opt_new == nullptr)
             //FIXME This may happen when executing some test cases.
@@ -272,9 +276,14 @@ static t_config_option_keys print_config_diffs(
 static t_config_option_keys full_print_config_diffs(const DynamicPrintConfig &current_full_config, const DynamicPrintConfig &new_full_config, int plate_index)
 {
     t_config_option_keys full_config_diff;
-    for (const t_config_option_key &opt_key : new_full_config.keys()) {
-        const ConfigOption *opt_old = current_full_config.option(opt_key);
-        const ConfigOption *opt_new = new_full_config.option(opt_key);
+    // Both configs keep their options sorted by key, walk them in parallel instead of looking up each key.
+    auto it_old = current_full_config.cbegin();
+    for (auto it_new = new_full_config.cbegin(); it_new != new_full_config.cend(); ++ it_new) {
+        const t_config_option_key &opt_key = it_new->first;
+        while (it_old != current_full_config.cend() && it_old->first < opt_key)
+            ++ it_old;
+        const ConfigOption *opt_old = it_old != current_full_config.cend() && it_old->first == opt_key ? it_old->second.get() : nullptr;
+        const ConfigOption *opt_new = it_new->second.get();
         if (opt_old == nullptr || *opt_new != *opt_old) {
             //BBS: add plate_index logic for wipe_tower_x/wipe_tower_y
             if (opt_old && (!opt_key.compare("wipe_tower_x") || !opt_key.compare("wipe_tower_y"))) {
@@ -697,7 +706,7 @@ bool verify_update_print_object_regions(
     size_t                              num_extruders,
     const std::vector<unsigned int>    &painting_extruders,
     PrintObjectRegions                 &print_object_regions,
-    const std::function<void(const PrintRegionConfig&, const PrintRegionConfig&, const t_config_option_keys&)> &callback_invalidate)
+    const std::function<void(const PrintRegion&, const PrintRegionConfig&, const PrintRegionConfig&, const t_config_option_keys&)> &callback_invalidate)
 {
     // Sort by ModelVolume ID.
     model_volumes_sort_by_id(model_volumes);
@@ -758,7 +767,7 @@ bool verify_update_print_object_regions(
                         // Region is referenced for the first time. Just change its parameters.
                         // Stop the background process before assigning new configuration to the regions.
                         t_config_option_keys diff = region.region->config().diff(cfg);
-                        callback_invalidate(region.region->config(), cfg, diff);
+                        callback_invalidate(*region.region, region.region->config(), cfg, diff);
                         region.region->config_apply_only(cfg, diff, false);
                     } else {
                         // Region is referenced multiple times, thus the region is being split. We need to reslice.
@@ -783,7 +792,7 @@ bool verify_update_print_object_regions(
                     // Region is referenced for the first time. Just change its parameters.
                     // Stop the background process before assigning new configuration to the regions.
                     t_config_option_keys diff = region.region->config().diff(cfg);
-                    callback_invalidate(region.region->config(), cfg, diff);
+                    callback_invalidate(*region.region, region.region->config(), cfg, diff);
                     region.region->config_apply_only(cfg, diff, false);
                 } else {
                     // Region is referenced multiple times, thus the region is being split. We need to reslice.
@@ -1499,10 +1508,10 @@ Print::ApplyStatus Print::apply(const Model &model, DynamicPrintConfig new_full_
                     num_extruders ,
                     painting_extruders,
                     *print_object_regions,
-                    [it_print_object, it_print_object_end, &update_apply_status](const PrintRegionConfig &old_config, const PrintRegionConfig &new_config, const t_config_option_keys &diff_keys) {
+                    [it_print_object, it_print_object_end, &update_apply_status](const PrintRegion &region, const PrintRegionConfig &old_config, const PrintRegionConfig &new_config, const t_config_option_keys &diff_keys) {
                         for (auto it = it_print_object; it != it_print_object_end; ++it)
                             if ((*it)->m_shared_regions != nullptr)
-                                update_apply_status((*it)->invalidate_state_by_config_options(old_config, new_config, diff_keys));
+                                update_apply_status((*it)->invalidate_state_by_config_options(old_config, new_config, diff_keys, &region));
                     })) {
                 // Regions are valid, just keep them.
             } else {
@@ -36,6 +36,8 @@
 #include "libslic3r.h"
 #include "Config.hpp"
 #include "Polygon.hpp"
+#include <typeinfo>
+#include <unordered_map>
 #include <boost/preprocessor/facilities/empty.hpp>
 #include <boost/preprocessor/punctuation/comma_if.hpp>
 #include <boost/preprocessor/seq/for_each.hpp>
@@ -494,7 +496,7 @@ protected:
         }
 
     protected:
-        std::map<std::string, ptrdiff_t>    m_map_name_to_offset;
+        std::unordered_map<std::string, ptrdiff_t>  m_map_name_to_offset;
     };
 
     // Parametrized by the type of the topmost class owning the options.
@@ -523,6 +525,32 @@ protected:
         const std::vector<std::string>& keys()      const { return m_keys; }
         const T&                        defaults()  const { return *m_defaults; }
 
+        // Options differing in the two configs. The options are visited through the table of offsets, they are not looked up by name.
+        t_config_option_keys diff(const T *lhs, const T *rhs) const
+        {
+            t_config_option_keys out;
+            for (size_t i = 0; i < m_keys.size(); ++ i)
+                if (*this->opt_at(i, lhs) != *this->opt_at(i, rhs))
+                    out.emplace_back(m_keys[i]);
+            return out;
+        }
+
+        // Options differing from the options present in a DynamicConfig. Both the keys of this cache and the keys of
+        // a DynamicConfig are sorted, thus the two are merged in a single pass.
+        t_config_option_keys diff(const T *lhs, const DynamicConfig &rhs) const
+        {
+            t_config_option_keys out;
+            auto it_rhs = rhs.cbegin();
+            for (size_t i = 0; i < m_keys.size() && it_rhs != rhs.cend(); ++ i) {
+                const std::string &key = m_keys[i];
+                while (it_rhs != rhs.cend() && it_rhs->first < key)
+                    ++ it_rhs;
+                if (it_rhs != rhs.cend() && it_rhs->first == key && *this->opt_at(i, lhs) != *it_rhs->second)
+                    out.emplace_back(key);
+            }
+            return out;
+        }
+
         // To be called during the StaticCache setup.
         // Collect option keys from m_map_name_to_offset,
         // assign default values to m_defaults.
@@ -532,6 +560,8 @@ protected:
             m_defaults = defaults;
             m_keys.clear();
             m_keys.reserve(m_map_name_to_offset.size());
+            m_offsets.clear();
+            m_offsets.reserve(m_map_name_to_offset.size());
             for (const auto &kvp : defs->options) {
                 // Find the option given the option name kvp.first by an offset from (char*)m_defaults.
                 ConfigOption *opt = this->optptr(kvp.first, m_defaults);
@@ -539,6 +569,7 @@ protected:
                     // This option is not defined by the ConfigBase of type T.
                     continue;
                 m_keys.emplace_back(kvp.first);
+                m_offsets.emplace_back(m_map_name_to_offset.find(kvp.first)->second);
                 const ConfigOptionDef *def = defs->get(kvp.first);
                 assert(def != nullptr);
                 if (def->default_value)
@@ -547,8 +578,15 @@ protected:
         }
 
     private:
+        // Option at position idx of keys().
+        const ConfigOption* opt_at(size_t idx, const T *owner) const
+            { return reinterpret_cast<const ConfigOption*>((const char*)owner + m_offsets[idx]); }
+
         T                                  *m_defaults;
+        // Sorted keys of the options of T.
         std::vector<std::string>            m_keys;
+        // Offsets of the options of T in the order of m_keys.
+        std::vector<ptrdiff_t>              m_offsets;
     };
 };
 
@@ -563,6 +601,19 @@ public: \
     /* Overrides ConfigBase::keys(). Collect names of all configuration values maintained by this configuration store. */ \
     t_config_option_keys     keys() const override { return s_cache_##CLASS_NAME.keys(); } \
     const t_config_option_keys& keys_ref() const override { return s_cache_##CLASS_NAME.keys(); } \
+    /* Overloads of ConfigBase::diff() walking the static table of options instead of looking the options up by name. */ \
+    /* Used only if both configs are exactly of type CLASS_NAME, otherwise the set of keys compared by ConfigBase::diff() would differ. */ \
+    using ConfigBase::diff; \
+    t_config_option_keys diff(const CLASS_NAME &other) const \
+    { \
+        return typeid(*this) == typeid(CLASS_NAME) && typeid(other) == typeid(CLASS_NAME) ? \
+            s_cache_##CLASS_NAME.diff(this, &other) : this->ConfigBase::diff(other); \
+    } \
+    t_config_option_keys diff(const DynamicConfig &other) const \
+    { \
+        return typeid(*this) == typeid(CLASS_NAME) ? \
+            s_cache_##CLASS_NAME.diff(this, other) : this->ConfigBase::diff(other); \
+    } \
     static const CLASS_NAME& defaults() { assert(s_cache_##CLASS_NAME.initialized()); return s_cache_##CLASS_NAME.defaults(); } \
 private: \
     friend int print_config_static_initializer(); \
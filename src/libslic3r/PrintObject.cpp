@@ -384,13 +384,16 @@ void PrintObject::make_perimeters()
         BOOST_LOG_TRIVIAL(debug) << "Generating extra perimeters for region " << region_id << " in parallel - end";
     }
 
+    // If the perimeters were invalidated for some layers only, the other layers keep their perimeters and fill_expolygons.
+    // prepare_infill() runs over all layers anyway and it reclassifies the fill surfaces from the fill_expolygons.
     BOOST_LOG_TRIVIAL(debug) << "Generating perimeters in parallel - start";
     tbb::parallel_for(
         tbb::blocked_range<size_t>(0, m_layers.size()),
         [this](const tbb::blocked_range<size_t>& range) {
             for (size_t layer_idx = range.begin(); layer_idx < range.end(); ++ layer_idx) {
                 m_print->throw_if_canceled();
-                m_layers[layer_idx]->make_perimeters();
+                if (m_perimeters_dirty.contains(m_layers[layer_idx]->print_z))
+                    m_layers[layer_idx]->make_perimeters();
             }
         }
     );
@@ -552,7 +555,8 @@ void PrintObject::infill()
             [this, &adaptive_fill_octree = adaptive_fill_octree, &support_fill_octree = support_fill_octree](const tbb::blocked_range<size_t>& range) {
                 for (size_t layer_idx = range.begin(); layer_idx < range.end(); ++ layer_idx) {
                     m_print->throw_if_canceled();
-                    m_layers[layer_idx]->make_fills(adaptive_fill_octree.get(), support_fill_octree.get(), this->m_lightning_generator.get());
+                    if (m_infill_dirty.contains(m_layers[layer_idx]->print_z))
+                        m_layers[layer_idx]->make_fills(adaptive_fill_octree.get(), support_fill_octree.get(), this->m_lightning_generator.get());
                 }
             }
         );
@@ -575,7 +579,9 @@ void PrintObject::ironing()
             [this](const tbb::blocked_range<size_t>& range) {
                 for (size_t layer_idx = range.begin(); layer_idx < range.end(); ++ layer_idx) {
                     m_print->throw_if_canceled();
-                    m_layers[layer_idx]->make_ironing();
+                    // Ironing is appended to the fills, thus only the layers with regenerated fills are ironed again.
+                    if (m_infill_dirty.contains(m_layers[layer_idx]->print_z))
+                        m_layers[layer_idx]->make_ironing();
                 }
             }
         );
@@ -703,7 +709,9 @@ void PrintObject::simplify_extrusion_path()
             [this](const tbb::blocked_range<size_t>& range) {
                 for (size_t layer_idx = range.begin(); layer_idx < range.end(); ++ layer_idx) {
                     m_print->throw_if_canceled();
-                    m_layers[layer_idx]->simplify_wall_extrusion_path();
+                    // Layers outside of the dirty span keep their already simplified perimeters, simplifying them again is lossy.
+                    if (m_perimeters_dirty.contains(m_layers[layer_idx]->print_z))
+                        m_layers[layer_idx]->simplify_wall_extrusion_path();
                 }
             }
         );
@@ -721,7 +729,8 @@ void PrintObject::simplify_extrusion_path()
             [this](const tbb::blocked_range<size_t>& range) {
                 for (size_t layer_idx = range.begin(); layer_idx < range.end(); ++layer_idx) {
                     m_print->throw_if_canceled();
-                    m_layers[layer_idx]->simplify_infill_extrusion_path();
+                    if (m_infill_dirty.contains(m_layers[layer_idx]->print_z))
+                        m_layers[layer_idx]->simplify_infill_extrusion_path();
                 }
             }
         );
@@ -877,7 +886,8 @@ SupportLayerPtrs::iterator PrintObject::insert_support_layer(SupportLayerPtrs::i
 // Called by Print::apply().
 // This method only accepts PrintObjectConfig and PrintRegionConfig option keys.
 bool PrintObject::invalidate_state_by_config_options(
-    const ConfigOptionResolver &old_config, const ConfigOptionResolver &new_config, const std::vector<t_config_option_key> &opt_keys)
+    const ConfigOptionResolver &old_config, const ConfigOptionResolver &new_config, const std::vector<t_config_option_key> &opt_keys,
+    const PrintRegion *region)
 {
     if (opt_keys.empty())
         return false;
@@ -1159,8 +1169,15 @@ bool PrintObject::invalidate_state_by_config_options(
     }
 
     sort_remove_duplicates(steps);
-    for (PrintObjectStep step : steps)
-        invalidated |= this->invalidate_step(step);
+    if (region != nullptr && ! steps.empty()) {
+        // Options of a single region changed, for example by a layer range modifier or by a modifier volume.
+        // Perimeters and infill are generated layer by layer, thus they are only regenerated at the layers printing the region.
+        for (PrintObjectStep step : steps)
+            invalidated |= this->invalidate_step_for_layers(step, *region);
+    } else {
+        for (PrintObjectStep step : steps)
+            invalidated |= this->invalidate_step(step);
+    }
     return invalidated;
 }
 
@@ -1168,6 +1185,12 @@ bool PrintObject::invalidate_step(PrintObjectStep step)
 {
 	bool invalidated = Inherited::invalidate_step(step);
 
+    // The layers are regenerated completely by the invalidated step and by the steps depending on it.
+    if (step == posSlice || step == posPerimeters)
+        m_perimeters_dirty.reset();
+    if (step == posSlice || step == posPerimeters || step == posPrepareInfill || step == posInfill)
+        m_infill_dirty.reset();
+
     // propagate to dependent steps
     if (step == posPerimeters) {
 		invalidated |= this->invalidate_steps({ posPrepareInfill, posInfill, posIroning, posSimplifyPath, posSimplifyInfill });
@@ -1202,9 +1225,55 @@ bool PrintObject::invalidate_all_steps()
     bool result = Inherited::invalidate_all_steps() | m_print->invalidate_all_steps();
 	// Then reset some of the depending values.
 	m_slicing_params.valid = false;
+    m_perimeters_dirty.reset();
+    m_infill_dirty.reset();
 	return result;
 }
 
+bool PrintObject::invalidate_step_for_layers(PrintObjectStep step, const PrintRegion &region)
+{
+    DirtyLayers *dirty = step == posPerimeters ? &m_perimeters_dirty : step == posInfill ? &m_infill_dirty : nullptr;
+    // Layers of an object sharing its layers with another object are regenerated as a whole.
+    bool shared = m_shared_object != nullptr ||
+        std::any_of(m_print->objects().begin(), m_print->objects().end(), [this](const PrintObject *object) { return object->get_shared_object() == this; });
+    if (dirty == nullptr || shared)
+        return this->invalidate_step(step);
+
+    bool        was_done  = this->is_step_done(step);
+    DirtyLayers new_dirty = *dirty;
+    // Invalidate the step and its dependencies, which stops the background processing and resets the dirty layers.
+    // The slices are not being modified from now on, they may be inspected by region_z_span().
+    bool invalidated = this->invalidate_step(step);
+    // Layers to regenerate: If the step was done, just the layers printing the region. If the step has not finished yet, then either
+    // it was invalidated for some layers only (merge the layers), or it was invalidated completely (keep all layers).
+    if (was_done || ! new_dirty.all) {
+        std::pair<coordf_t, coordf_t> z_span = this->region_z_span(region);
+        if (was_done) {
+            new_dirty.all   = false;
+            new_dirty.min_z = z_span.first;
+            new_dirty.max_z = z_span.second;
+        } else {
+            new_dirty.min_z = std::min(new_dirty.min_z, z_span.first);
+            new_dirty.max_z = std::max(new_dirty.max_z, z_span.second);
+        }
+        BOOST_LOG_TRIVIAL(debug) << (step == posPerimeters ? "Perimeters" : "Infill") << " invalidated for layers from " << new_dirty.min_z << " to " << new_dirty.max_z;
+    }
+    *dirty = new_dirty;
+    return invalidated;
+}
+
+std::pair<coordf_t, coordf_t> PrintObject::region_z_span(const PrintRegion &region) const
+{
+    std::pair<coordf_t, coordf_t> out { std::numeric_limits<coordf_t>::max(), std::numeric_limits<coordf_t>::lowest() };
+    const int region_id = region.print_object_region_id();
+    for (const Layer *layer : m_layers)
+        if (region_id >= 0 && region_id < int(layer->region_count()) && ! layer->get_region(region_id)->slices.empty()) {
+            out.first  = std::min(out.first,  layer->print_z);
+            out.second = std::max(out.second, layer->print_z);
+        }
+    return out;
+}
+
 // This function analyzes slices of a region (SurfaceCollection slices).
 // Each region slice (instance of Surface) is analyzed, whether it is supported or whether it is the top surface.
 // Initially all slices are of type stInternal.
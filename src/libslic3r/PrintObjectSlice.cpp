@@ -7,6 +7,7 @@
 //BBS
 #include "ShortestPath.hpp"
 
+#include <boost/functional/hash.hpp>
 #include <boost/log/trivial.hpp>
 
 #include <tbb/parallel_for.h>
@@ -44,24 +45,99 @@ LayerPtrs new_layers(
     return out;
 }
 
+bool VolumeSlicesCache::Key::operator==(const Key &rhs) const
+{
+    return mesh == rhs.mesh && zs == rhs.zs &&
+        params.mode == rhs.params.mode && params.slicing_mode_normal_below_layer == rhs.params.slicing_mode_normal_below_layer &&
+        params.mode_below == rhs.params.mode_below && params.trafo.matrix() == rhs.params.trafo.matrix() &&
+        params.closing_radius == rhs.params.closing_radius && params.extra_offset == rhs.params.extra_offset &&
+        params.resolution == rhs.params.resolution;
+}
+
+size_t VolumeSlicesCache::KeyHash::operator()(const Key &key) const
+{
+    size_t seed = std::hash<const TriangleMesh*>()(key.mesh);
+    boost::hash_range(seed, key.zs.begin(), key.zs.end());
+    boost::hash_combine(seed, int(key.params.mode));
+    boost::hash_combine(seed, key.params.slicing_mode_normal_below_layer);
+    boost::hash_combine(seed, int(key.params.mode_below));
+    boost::hash_range(seed, key.params.trafo.data(), key.params.trafo.data() + 16);
+    boost::hash_combine(seed, key.params.closing_radius);
+    boost::hash_combine(seed, key.params.extra_offset);
+    boost::hash_combine(seed, key.params.resolution);
+    return seed;
+}
+
+VolumeSlicesCache::Slices VolumeSlicesCache::get(const TriangleMesh *mesh, const std::vector<float> &zs, const MeshSlicingParamsEx &params,
+    const std::function<std::vector<ExPolygons>()> &slice_fn)
+{
+    Key key { mesh, zs, params };
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (auto it = m_map.find(key); it != m_map.end())
+            return it->second;
+    }
+    // Slice outside of the lock. Two objects may slice the same volume at the same time, the first result is kept.
+    auto slices = std::make_shared<const std::vector<ExPolygons>>(slice_fn());
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_map.emplace(std::move(key), std::move(slices)).first->second;
+}
+
+void VolumeSlicesCache::reset(const std::vector<PrintObject*> &objects)
+{
+    this->clear();
+    std::set<const TriangleMesh*> meshes;
+    for (const PrintObject *object : objects)
+        for (const ModelVolume *volume : object->model_object()->volumes)
+            if (! meshes.insert(&volume->mesh()).second)
+                m_shared_meshes.insert(&volume->mesh());
+}
+
+void VolumeSlicesCache::clear()
+{
+    m_shared_meshes.clear();
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_map.clear();
+}
+
 // Slice single triangle mesh.
+// If cache is provided and the mesh is shared with other volumes, the slices are shared with the volumes
+// differing from this one by a translation in XY only.
 static std::vector<ExPolygons> slice_volume(
     const ModelVolume             &volume,
     const std::vector<float>      &zs,
     const MeshSlicingParamsEx     &params,
-    const std::function<void()>   &throw_on_cancel_callback)
+    const std::function<void()>   &throw_on_cancel_callback,
+    VolumeSlicesCache             *cache = nullptr)
 {
     std::vector<ExPolygons> layers;
     if (! zs.empty()) {
-        indexed_triangle_set its = volume.mesh().its;
-        if (its.indices.size() > 0) {
-            MeshSlicingParamsEx params2 { params };
-            params2.trafo = params2.trafo * volume.get_matrix();
-            if (params2.trafo.rotation().determinant() < 0.)
-                its_flip_triangles(its);
-            layers = slice_mesh_ex(its, zs, params2, throw_on_cancel_callback);
-            throw_on_cancel_callback();
-        }
+        MeshSlicingParamsEx params2 { params };
+        params2.trafo = params2.trafo * volume.get_matrix();
+        auto slice = [&volume, &zs, &throw_on_cancel_callback](const MeshSlicingParamsEx &params) {
+            std::vector<ExPolygons> layers;
+            indexed_triangle_set its = volume.mesh().its;
+            if (its.indices.size() > 0) {
+                if (params.trafo.rotation().determinant() < 0.)
+                    its_flip_triangles(its);
+                layers = slice_mesh_ex(its, zs, params, throw_on_cancel_callback);
+                throw_on_cancel_callback();
+            }
+            return layers;
+        };
+        if (cache != nullptr && cache->is_shared(&volume.mesh())) {
+            // Slice without the XY translation, translate the shared slices.
+            const Point shift(scaled(params2.trafo.translation().x()), scaled(params2.trafo.translation().y()));
+            params2.trafo.translation().x() = 0.;
+            params2.trafo.translation().y() = 0.;
+            VolumeSlicesCache::Slices slices = cache->get(&volume.mesh(), zs, params2, [&slice, &params2]() { return slice(params2); });
+            layers = *slices;
+            if (shift != Point::Zero())
+                for (ExPolygons &expolygons : layers)
+                    for (ExPolygon &expolygon : expolygons)
+                        expolygon.translate(shift);
+        } else
+            layers = slice(params2);
     }
     return layers;
 }
@@ -73,13 +149,14 @@ static std::vector<ExPolygons> slice_volume(
     const std::vector<float>                    &z,
     const std::vector<t_layer_height_range>     &ranges,
     const MeshSlicingParamsEx                   &params,
-    const std::function<void()>                 &throw_on_cancel_callback)
+    const std::function<void()>                 &throw_on_cancel_callback,
+    VolumeSlicesCache                           *cache = nullptr)
 {
     std::vector<ExPolygons> out;
     if (! z.empty() && ! ranges.empty()) {
         if (ranges.size() == 1 && z.front() >= ranges.front().first && z.back() < ranges.front().second) {
             // All layers fit into a single range.
-            out = slice_volume(volume, z, params, throw_on_cancel_callback);
+            out = slice_volume(volume, z, params, throw_on_cancel_callback, cache);
         } else {
             std::vector<float>                     z_filtered;
             std::vector<std::pair<size_t, size_t>> n_filtered;
@@ -95,7 +172,7 @@ static std::vector<ExPolygons> slice_volume(
                     n_filtered.emplace_back(std::make_pair(first, i));
             }
             if (! n_filtered.empty()) {
-                std::vector<ExPolygons> layers = slice_volume(volume, z_filtered, params, throw_on_cancel_callback);
+                std::vector<ExPolygons> layers = slice_volume(volume, z_filtered, params, throw_on_cancel_callback, cache);
                 out.assign(z.size(), ExPolygons());
                 i = 0;
                 for (const std::pair<size_t, size_t> &span : n_filtered)
@@ -123,7 +200,8 @@ static std::vector<VolumeSlices> slice_volumes_inner(
     ModelVolumePtrs                                           model_volumes,
     const std::vector<PrintObjectRegions::LayerRangeRegions> &layer_ranges,
     const std::vector<float>                                 &zs,
-    const std::function<void()>                              &throw_on_cancel_callback)
+    const std::function<void()>                              &throw_on_cancel_callback,
+    VolumeSlicesCache                                        *cache)
 {
     model_volumes_sort_by_id(model_volumes);
 
@@ -177,7 +255,7 @@ static std::vector<VolumeSlices> slice_volumes_inner(
                     }
                     out.push_back({
                         model_volume->id(),
-                        slice_volume(*model_volume, zs, params, throw_on_cancel_callback)
+                        slice_volume(*model_volume, zs, params, throw_on_cancel_callback, cache)
                     });
                 }
             } else {
@@ -189,7 +267,7 @@ static std::vector<VolumeSlices> slice_volumes_inner(
                 if (! slicing_ranges.empty())
                     out.push_back({
                         model_volume->id(),
-                        slice_volume(*model_volume, zs, slicing_ranges, params, throw_on_cancel_callback)
+                        slice_volume(*model_volume, zs, slicing_ranges, params, throw_on_cancel_callback, cache)
                     });
             }
             if (! out.empty() && out.back().slices.empty())
@@ -1015,7 +1093,7 @@ void PrintObject::slice_volumes()
     if (!slice_zs.empty()) {
         objSliceByVolume = slice_volumes_inner(
             print->config(), this->config(), this->trafo_centered(),
-            this->model_object()->volumes, m_shared_regions->layer_ranges, slice_zs, throw_on_cancel_callback);
+            this->model_object()->volumes, m_shared_regions->layer_ranges, slice_zs, throw_on_cancel_callback, &print->m_volume_slices_cache);
     }
 
     //BBS: "model_part" volumes are grouded according to their connections
@@ -1370,7 +1448,7 @@ std::vector<Polygons> PrintObject::slice_support_volumes(const ModelVolumeType m
         params.trafo = this->trafo_centered();
         for (; it_volume != it_volume_end; ++ it_volume)
             if ((*it_volume)->type() == model_volume_type) {
-                std::vector<ExPolygons> slices2 = slice_volume(*(*it_volume), zs, params, throw_on_cancel_callback);
+                std::vector<ExPolygons> slices2 = slice_volume(*(*it_volume), zs, params, throw_on_cancel_callback, &print->m_volume_slices_cache);
                 if (slices.empty()) {
                     slices.reserve(slices2.size());
                     for (ExPolygons &src : slices2)
@@ -253,6 +253,12 @@ void TreeModelVolumes::precalculate(const PrintObject& print_object, const coord
 
 //    m_precalculated = true;
     BOOST_LOG_TRIVIAL(info) << "Precalculating collision took" << dur_col << " ms. Precalculating avoidance took " << dur_avo << " ms.";
+    {
+        RadiusLayerPolygonCache::Stats stats_collision = m_collision_cache.stats();
+        RadiusLayerPolygonCache::Stats stats_avoidance = m_avoidance_cache.stats();
+        BOOST_LOG_TRIVIAL(debug) << "Contended cache locks: collision " << stats_collision.contended_reads << " reads, " << stats_collision.contended_writes <<
+            " writes; avoidance " << stats_avoidance.contended_reads << " reads, " << stats_avoidance.contended_writes << " writes.";
+    }
 
 #if 0
     // Paint caches into SVGs:
@@ -855,10 +861,13 @@ coord_t TreeModelVolumes::ceilRadius(const coord_t radius) const
 
 void TreeModelVolumes::RadiusLayerPolygonCache::allocate_layers(size_t num_layers)
 {
-    if (num_layers > m_data.size()) {
-        if (num_layers > m_data.capacity())
-            reserve_power_of_2(m_data, num_layers);
-        m_data.resize(num_layers, {});
+    if (num_layers > m_num_layers.load(std::memory_order_acquire)) {
+        std::lock_guard<std::mutex> guard(m_allocate_mutex);
+        if (num_layers > m_num_layers.load(std::memory_order_relaxed)) {
+            // The new layers are constructed by grow_to_at_least(), only then they are published to the readers.
+            m_data.grow_to_at_least(num_layers);
+            m_num_layers.store(num_layers, std::memory_order_release);
+        }
     }
 }
 
@@ -866,10 +875,11 @@ void TreeModelVolumes::RadiusLayerPolygonCache::allocate_layers(size_t num_layer
 std::vector<std::pair<TreeModelVolumes::RadiusLayerPair, std::reference_wrapper<const Polygons>>> TreeModelVolumes::RadiusLayerPolygonCache::sorted() const
 {
     std::vector<std::pair<RadiusLayerPair, std::reference_wrapper<const Polygons>>> out;
-    for (auto &layer : m_data) {
-        auto layer_idx = LayerIndex(&layer - m_data.data());
-        for (auto &radius_polygons : layer)
-            out.emplace_back(std::make_pair(radius_polygons.first, layer_idx), radius_polygons.second);
+    for (size_t layer_idx = 0; layer_idx < m_num_layers.load(std::memory_order_acquire); ++ layer_idx) {
+        const LayerData &layer = m_data[layer_idx];
+        std::shared_lock<std::shared_mutex> lock(layer.mutex);
+        for (auto &radius_polygons : layer.radii)
+            out.emplace_back(std::make_pair(radius_polygons.first, LayerIndex(layer_idx)), *radius_polygons.second);
     }
     assert(std::is_sorted(out.begin(), out.end(), [](auto &l, auto &r){ return l.first.second < r.first.second || (l.first.second == r.first.second) && l.first.first < r.first.first; }));
     return out;
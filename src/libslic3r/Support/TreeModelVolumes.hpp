@@ -13,11 +13,16 @@
 #ifndef slic3r_TreeModelVolumes_hpp
 #define slic3r_TreeModelVolumes_hpp
 
+#include <atomic>
+#include <memory>
 #include <mutex>
+#include <shared_mutex>
 #include <unordered_map>
 
 #include <boost/functional/hash.hpp>
 
+#include <tbb/concurrent_vector.h>
+
 #include "TreeSupportCommon.hpp"
 
 #include "../Point.hpp"
@@ -200,42 +205,74 @@ private:
      */
     using RadiusLayerPair             = std::pair<coord_t, LayerIndex>;
     class RadiusLayerPolygonCache {
-        // Map from radius to Polygons. Cache of one layer collision regions.
-        using LayerData = std::map<coord_t, Polygons>;
-        // Vector of layers, at each layer map of radius to Polygons.
-        // Reference to Polygons returned shall be stable to insertion.
-        using Layers = std::vector<LayerData>;
+        // Cache of one layer collision regions: Flat vector of radii sorted by radius, each with its Polygons.
+        // Polygons are allocated separately, thus the references to Polygons returned shall be stable to insertion.
+        struct LayerData {
+            using Radii = std::vector<std::pair<coord_t, std::unique_ptr<Polygons>>>;
+            Radii                       radii;
+            // Each layer is locked separately, so that threads working on different layers do not block each other
+            // and the readers of the same layer only block the writers.
+            mutable std::shared_mutex   mutex;
+
+            Radii::const_iterator lower_bound(coord_t radius) const
+                { return std::lower_bound(radii.begin(), radii.end(), radius, [](const auto &l, coord_t r) { return l.first < r; }); }
+            const Polygons* find(coord_t radius) const
+                { auto it = this->lower_bound(radius); return it == radii.end() || it->first != radius ? nullptr : it->second.get(); }
+            // Don't overwrite an already cached radius, as the Polygons may be referenced.
+            void emplace(coord_t radius, Polygons &&polygons) {
+                auto it = std::lower_bound(radii.begin(), radii.end(), radius, [](const auto &l, coord_t r) { return l.first < r; });
+                if (it == radii.end() || it->first != radius)
+                    radii.emplace(it, radius, std::make_unique<Polygons>(std::move(polygons)));
+            }
+        };
+        // Vector of layers, at each layer vector of radius to Polygons.
+        // The layers are never relocated when the vector grows, thus a layer is accessed without locking the whole cache.
+        using Layers = tbb::concurrent_vector<LayerData>;
     public:
+        // Number of lock acquisitions, which had to wait for another thread.
+        struct Stats {
+            size_t contended_reads  { 0 };
+            size_t contended_writes { 0 };
+        };
+
         RadiusLayerPolygonCache() = default;
-        RadiusLayerPolygonCache(RadiusLayerPolygonCache &&rhs) : m_data(std::move(rhs.m_data)) {}
-        RadiusLayerPolygonCache& operator=(RadiusLayerPolygonCache &&rhs) { m_data = std::move(rhs.m_data); return *this; }
+        RadiusLayerPolygonCache(RadiusLayerPolygonCache &&rhs) : m_data(std::move(rhs.m_data)), m_num_layers(rhs.m_num_layers.load()) { rhs.m_num_layers = 0; }
+        RadiusLayerPolygonCache& operator=(RadiusLayerPolygonCache &&rhs) { m_data = std::move(rhs.m_data); m_num_layers = rhs.m_num_layers.load(); rhs.m_num_layers = 0; return *this; }
 
         RadiusLayerPolygonCache(const RadiusLayerPolygonCache&) = delete;
         RadiusLayerPolygonCache& operator=(const RadiusLayerPolygonCache&) = delete;
 
         void insert(std::vector<std::pair<RadiusLayerPair, Polygons>> &&in) {
-            std::lock_guard<std::mutex> guard(m_mutex);
-            for (auto &d : in)
-                this->get_allocate_layer_data(d.first.second).emplace(d.first.first, std::move(d.second));
+            for (auto &d : in) {
+                LayerData &layer = this->get_allocate_layer_data(d.first.second);
+                std::unique_lock<std::shared_mutex> lock = this->lock_unique(layer);
+                layer.emplace(d.first.first, std::move(d.second));
+            }
         }
         // by layer
         void insert(std::vector<std::pair<coord_t, Polygons>> &&in, coord_t radius) {
-            std::lock_guard<std::mutex> guard(m_mutex);
-            for (auto &d : in)
-                this->get_allocate_layer_data(d.first).emplace(radius, std::move(d.second));
+            for (auto &d : in) {
+                LayerData &layer = this->get_allocate_layer_data(d.first);
+                std::unique_lock<std::shared_mutex> lock = this->lock_unique(layer);
+                layer.emplace(radius, std::move(d.second));
+            }
         }
         void insert(std::vector<Polygons> &&in, coord_t first_layer_idx, coord_t radius) {
-            std::lock_guard<std::mutex> guard(m_mutex);
             allocate_layers(first_layer_idx + in.size());
-            for (auto &d : in)
-                m_data[first_layer_idx ++].emplace(radius, std::move(d));
+            for (auto &d : in) {
+                LayerData &layer = m_data[first_layer_idx ++];
+                std::unique_lock<std::shared_mutex> lock = this->lock_unique(layer);
+                layer.emplace(radius, std::move(d));
+            }
         }
         void insert(LayerPolygonCache &&in, coord_t radius) {
-            std::lock_guard<std::mutex> guard(m_mutex);
             LayerIndex i = in.begin();
             allocate_layers(i + LayerIndex(in.size()));
-            for (auto &d : in.polygons_mutable())
-                m_data[i ++].emplace(radius, std::move(d));
+            for (auto &d : in.polygons_mutable()) {
+                LayerData &layer = m_data[i ++];
+                std::unique_lock<std::shared_mutex> lock = this->lock_unique(layer);
+                layer.emplace(radius, std::move(d));
+            }
         }
         /*!
          * \brief Checks a cache for a given RadiusLayerPair and returns it if it is found
@@ -243,29 +280,29 @@ private:
          * \return A wrapped optional reference of the requested area (if it was found, an empty optional if nothing was found)
          */
         std::optional<std::reference_wrapper<const Polygons>> getArea(const TreeModelVolumes::RadiusLayerPair &key) const {
-            std::lock_guard<std::mutex> guard(m_mutex);
-            if (key.second >= LayerIndex(m_data.size()))
+            const LayerData *layer = this->layer_data(key.second);
+            if (layer == nullptr)
                 return std::optional<std::reference_wrapper<const Polygons>>{};
-            const auto &layer = m_data[key.second];
-            auto it = layer.find(key.first);
-            return it == layer.end() ? 
-                std::optional<std::reference_wrapper<const Polygons>>{} : std::optional<std::reference_wrapper<const Polygons>>{ it->second };
+            std::shared_lock<std::shared_mutex> lock = this->lock_shared(*layer);
+            const Polygons *polygons = layer->find(key.first);
+            return polygons == nullptr ? 
+                std::optional<std::reference_wrapper<const Polygons>>{} : std::optional<std::reference_wrapper<const Polygons>>{ *polygons };
         }
         // Get a collision area at a given layer for a radius that is a lower or equial to the key radius.
         std::optional<std::pair<coord_t, std::reference_wrapper<const Polygons>>> get_lower_bound_area(const TreeModelVolumes::RadiusLayerPair &key) const {
-            std::lock_guard<std::mutex> guard(m_mutex);
-            if (key.second >= LayerIndex(m_data.size()))
+            const LayerData *layer = this->layer_data(key.second);
+            if (layer == nullptr)
                 return {};
-            const auto &layer = m_data[key.second];
-            if (layer.empty())
+            std::shared_lock<std::shared_mutex> lock = this->lock_shared(*layer);
+            if (layer->radii.empty())
                 return {};
-            auto it = layer.lower_bound(key.first);
-            if (it == layer.end() || it->first != key.first) {
-                if (it == layer.begin())
+            auto it = layer->lower_bound(key.first);
+            if (it == layer->radii.end() || it->first != key.first) {
+                if (it == layer->radii.begin())
                     return {};
                 -- it;
             }
-            return std::make_pair(it->first, std::reference_wrapper<const Polygons>(it->second));
+            return std::make_pair(it->first, std::reference_wrapper<const Polygons>(*it->second));
         }
         /*!
          * \brief Get the highest already calculated layer in the cache.
@@ -275,11 +312,13 @@ private:
          * \return A wrapped optional reference of the requested area (if it was found, an empty optional if nothing was found)
          */
         LayerIndex getMaxCalculatedLayer(coord_t radius) const {
-            std::lock_guard<std::mutex> guard(m_mutex);
-            auto layer_idx = LayerIndex(m_data.size()) - 1;
-            for (; layer_idx > 0; -- layer_idx)
-                if (const auto &layer = m_data[layer_idx]; layer.find(radius) != layer.end())
+            auto layer_idx = LayerIndex(m_num_layers.load(std::memory_order_acquire)) - 1;
+            for (; layer_idx > 0; -- layer_idx) {
+                const LayerData &layer = m_data[layer_idx];
+                std::shared_lock<std::shared_mutex> lock = this->lock_shared(layer);
+                if (layer.find(radius) != nullptr)
                     break;
+            }
             // The placeable on model areas do not exist on layer 0, as there can not be model below it. As such it may be possible that layer 1 is available, but layer 0 does not exist.
             return layer_idx == 0 ? -1 : layer_idx;
         }
@@ -287,25 +326,51 @@ private:
         // For debugging purposes, sorted by layer index, then by radius.
         [[nodiscard]] std::vector<std::pair<RadiusLayerPair, std::reference_wrapper<const Polygons>>> sorted() const;
 
-        void clear() { m_data.clear(); }
+        Stats stats() const { return { m_contended_reads.load(std::memory_order_relaxed), m_contended_writes.load(std::memory_order_relaxed) }; }
+
+        // Not thread safe, the cache must not be accessed by other threads while clearing.
+        void clear() { m_data.clear(); m_num_layers = 0; }
         void clear_all_but_radius0() { 
-            for (LayerData &l : m_data) {
-                auto begin = l.begin();
-                auto end = l.end();
-                if (begin != end && ++ begin != end)
-                    l.erase(begin, end);
-            }
+            for (LayerData &l : m_data)
+                if (l.radii.size() > 1)
+                    l.radii.erase(l.radii.begin() + 1, l.radii.end());
         }
 
     private:
+        // Layer at layer_idx if it has been allocated already, otherwise nullptr.
+        const LayerData*    layer_data(LayerIndex layer_idx) const {
+            return size_t(layer_idx) < m_num_layers.load(std::memory_order_acquire) ? &m_data[layer_idx] : nullptr;
+        }
         LayerData&          get_allocate_layer_data(LayerIndex layer_idx) {
             allocate_layers(layer_idx + 1);
             return m_data[layer_idx];
         }
         void                allocate_layers(size_t num_layers);
 
-        Layers              m_data;
-        mutable std::mutex  m_mutex;
+        std::shared_lock<std::shared_mutex> lock_shared(const LayerData &layer) const {
+            std::shared_lock<std::shared_mutex> lock(layer.mutex, std::try_to_lock);
+            if (! lock.owns_lock()) {
+                m_contended_reads.fetch_add(1, std::memory_order_relaxed);
+                lock.lock();
+            }
+            return lock;
+        }
+        std::unique_lock<std::shared_mutex> lock_unique(LayerData &layer) {
+            std::unique_lock<std::shared_mutex> lock(layer.mutex, std::try_to_lock);
+            if (! lock.owns_lock()) {
+                m_contended_writes.fetch_add(1, std::memory_order_relaxed);
+                lock.lock();
+            }
+            return lock;
+        }
+
+        Layers                      m_data;
+        // Number of layers of m_data, which were fully constructed and which may be accessed by the readers.
+        std::atomic<size_t>         m_num_layers { 0 };
+        // Serializes growing of m_data.
+        std::mutex                  m_allocate_mutex;
+        mutable std::atomic<size_t> m_contended_reads  { 0 };
+        mutable std::atomic<size_t> m_contended_writes { 0 };
     };
 
 
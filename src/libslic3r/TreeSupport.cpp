@@ -2612,20 +2612,21 @@ void TreeSupport::drop_nodes(std::vector<std::vector<Node*>>& contact_nodes)
     m_spanning_trees.resize(contact_nodes.size());
     //m_mst_line_x_layer_contour_caches.resize(contact_nodes.size());
 
-    if (0)
-    {// get outlines below and avoidance area using tbb
-     // This part only takes very little time, so we disable it.
+    {
+        // Precalculate the avoidance areas in parallel. Otherwise the first request of an avoidance at a high layer
+        // recurses down to the first layer on a single thread while dropping the nodes.
         typedef std::chrono::high_resolution_clock clock_;
         typedef std::chrono::duration<double, std::ratio<1> > second_;
         std::chrono::time_point<clock_> t0{ clock_::now() };
 
-        // get all the possible radiis
-        std::vector<std::set<coordf_t> > all_layer_radius(m_highest_overhang_layer+1);
+        // Estimate the radii of the branches at each layer by propagating the distances of the contact nodes down.
+        // Nodes merged while dropping may grow faster, their avoidance areas are calculated on demand.
+        std::vector<std::pair<coordf_t, size_t>> radii_layers;
         std::vector<std::set<coordf_t>> all_layer_node_dist(m_highest_overhang_layer + 1);
+        radii_layers.emplace_back(0., m_highest_overhang_layer);
         for (size_t layer_nr = m_highest_overhang_layer; layer_nr > 0; layer_nr--)
         {
             if (layer_heights[layer_nr].height < EPSILON) continue;
-            auto& layer_radius = all_layer_radius[layer_nr];
             auto& layer_node_dist = all_layer_node_dist[layer_nr];
             for (Node *p_node : contact_nodes[layer_nr]) {
                 layer_node_dist.emplace(p_node->dist_mm_to_top);
@@ -2635,21 +2636,12 @@ void TreeSupport::drop_nodes(std::vector<std::vector<Node*>>& contact_nodes)
                 for (auto node_dist : layer_node_dist)
                     all_layer_node_dist[layer_nr_next].emplace(node_dist + layer_heights[layer_nr].height);
             }
-            for (auto node_dist : layer_node_dist) {
-                layer_radius.emplace(calc_branch_radius(branch_radius, node_dist, diameter_angle_scale_factor));
-            }
+            // The avoidance is requested for the layer below the nodes.
+            for (auto node_dist : layer_node_dist)
+                radii_layers.emplace_back(calc_branch_radius(branch_radius, node_dist, diameter_angle_scale_factor), layer_nr_next);
         }
-        // parallel pre-compute avoidance
-        //tbb::parallel_for(tbb::blocked_range<size_t>(1, m_highest_overhang_layer), [&](const tbb::blocked_range<size_t> &range) {
-            //for (size_t layer_nr = range.begin(); layer_nr < range.end(); layer_nr++) {
-            for (size_t layer_nr = 0; layer_nr < all_layer_radius.size(); layer_nr++) {
-                BOOST_LOG_TRIVIAL(debug) << "pre calculate_avoidance layer=" << layer_nr;
-                for (auto node_radius : all_layer_radius[layer_nr]) {
-                    m_ts_data->get_avoidance(0, layer_nr);
-                    m_ts_data->get_avoidance(node_radius, layer_nr);
-                }
-            }
-        //});
+        all_layer_node_dist.clear();
+        m_ts_data->precalculate(radii_layers, [this]() { return m_object->print()->canceled(); });
 
         double duration{ std::chrono::duration_cast<second_>(clock_::now() - t0).count() };
         BOOST_LOG_TRIVIAL(debug) << "before m_avoidance_cache.size()=" << m_ts_data->m_avoidance_cache.size()
@@ -3598,15 +3590,33 @@ TreeSupportData::TreeSupportData(const PrintObject &object, coordf_t xy_distance
     }
 }
 
+TreeSupportData::CachedAreas& TreeSupportData::cache_entry(AreasCache &cache, const RadiusLayerPair &key)
+{
+    auto it = cache.find(key);
+    if (it == cache.end())
+        // If another thread inserted the same key in the meantime, its entry is returned and the new one is dropped.
+        it = cache.emplace(key, std::make_unique<CachedAreas>()).first;
+    return *it->second;
+}
+
+bool TreeSupportData::is_cached(const AreasCache &cache, const RadiusLayerPair &key)
+{
+    auto it = cache.find(key);
+    return it != cache.end() && it->second->calculated.load(std::memory_order_acquire);
+}
+
 const ExPolygons& TreeSupportData::get_collision(coordf_t radius, size_t layer_nr) const
 {
     profiler.tic();
     radius = ceil_radius(radius);
     RadiusLayerPair key{radius, layer_nr};
-    const auto it = m_collision_cache.find(key);
-    const ExPolygons& collision = it != m_collision_cache.end() ? it->second : calculate_collision(key);
+    CachedAreas &entry = cache_entry(m_collision_cache, key);
+    std::call_once(entry.once, [this, &key, &entry]() {
+        entry.areas = calculate_collision(key);
+        entry.calculated.store(true, std::memory_order_release);
+    });
     profiler.stage_add(STAGE_get_collision, true);
-    return collision;
+    return entry.areas;
 }
 
 const ExPolygons& TreeSupportData::get_avoidance(coordf_t radius, size_t layer_nr, int recursions) const
@@ -3614,11 +3624,68 @@ const ExPolygons& TreeSupportData::get_avoidance(coordf_t radius, size_t layer_n
     profiler.tic();
     radius = ceil_radius(radius);
     RadiusLayerPair key{radius, layer_nr, recursions };
-    const auto it = m_avoidance_cache.find(key);
-    const ExPolygons& avoidance = it != m_avoidance_cache.end() ? it->second : calculate_avoidance(key);
+    CachedAreas &entry = cache_entry(m_avoidance_cache, key);
+    // The avoidance depends on the avoidance of the layer below, which is calculated recursively.
+    // The recursion always goes down to lower layers, thus it never waits for an entry it is calculating itself.
+    std::call_once(entry.once, [this, &key, &entry]() {
+        entry.areas = calculate_avoidance(key);
+        entry.calculated.store(true, std::memory_order_release);
+    });
 
     profiler.stage_add(STAGE_GET_AVOIDANCE, true);
-    return avoidance;
+    return entry.areas;
+}
+
+void TreeSupportData::precalculate(const std::vector<std::pair<coordf_t, size_t>> &radii_layers, std::function<bool()> canceled) const
+{
+    if (layer_heights.empty())
+        return;
+
+    // Highest layer requested for each radius, the radii are rounded the same way as get_avoidance() does.
+    std::map<coordf_t, size_t> max_layer_by_radius;
+    for (const auto &[radius, layer_nr] : radii_layers) {
+        size_t &max_layer = max_layer_by_radius.emplace(ceil_radius(radius), 0).first->second;
+        max_layer = std::max(max_layer, std::min(layer_nr, layer_heights.size() - 1));
+    }
+
+    // Layers, at which the avoidance of a radius is calculated, bottom up: The chain of next_layer_nr links below the highest layer,
+    // which is the chain get_avoidance() recurses along.
+    std::vector<std::pair<coordf_t, std::vector<size_t>>> chains;
+    size_t num_keys = 0;
+    for (const auto &[radius, max_layer] : max_layer_by_radius) {
+        std::vector<size_t> layers;
+        for (size_t layer_nr = max_layer;; layer_nr = layer_heights[layer_nr].next_layer_nr) {
+            layers.emplace_back(layer_nr);
+            if (layer_nr == 0)
+                break;
+        }
+        std::reverse(layers.begin(), layers.end());
+        num_keys += layers.size();
+        chains.emplace_back(radius, std::move(layers));
+    }
+
+    // Collision areas are independent of each other.
+    std::vector<std::pair<coordf_t, size_t>> collision_keys;
+    collision_keys.reserve(num_keys);
+    for (const auto &[radius, layers] : chains)
+        for (size_t layer_nr : layers)
+            collision_keys.emplace_back(radius, layer_nr);
+    tbb::parallel_for(tbb::blocked_range<size_t>(0, collision_keys.size()),
+        [this, &collision_keys, &canceled](const tbb::blocked_range<size_t> &range) {
+            for (size_t i = range.begin(); i < range.end() && ! canceled(); ++ i)
+                this->get_collision(collision_keys[i].first, collision_keys[i].second);
+        });
+
+    // Avoidance areas of a radius bottom up, thus the avoidance of the layer below is always calculated already.
+    tbb::parallel_for(tbb::blocked_range<size_t>(0, chains.size(), 1),
+        [this, &chains, &canceled](const tbb::blocked_range<size_t> &range) {
+            for (size_t i = range.begin(); i < range.end(); ++ i)
+                for (size_t layer_nr : chains[i].second) {
+                    if (canceled())
+                        return;
+                    this->get_avoidance(chains[i].first, layer_nr);
+                }
+        });
 }
 
 Polygons TreeSupportData::get_contours(size_t layer_nr) const
@@ -3658,26 +3725,22 @@ coordf_t TreeSupportData::ceil_radius(coordf_t radius) const
 #endif
 }
 
-const ExPolygons& TreeSupportData::calculate_collision(const RadiusLayerPair& key) const
+ExPolygons TreeSupportData::calculate_collision(const RadiusLayerPair& key) const
 {
     assert(key.layer_nr < m_layer_outlines.size());
 
-    ExPolygons collision_areas = std::move(offset_ex(m_layer_outlines[key.layer_nr], scale_(key.radius)));
-    const auto ret = m_collision_cache.insert({ key, std::move(collision_areas) });
-    return ret.first->second;
+    return offset_ex(m_layer_outlines[key.layer_nr], scale_(key.radius));
 }
 
-const ExPolygons& TreeSupportData::calculate_avoidance(const RadiusLayerPair& key) const
+ExPolygons TreeSupportData::calculate_avoidance(const RadiusLayerPair& key) const
 {
     const auto& radius = key.radius;
     const auto& layer_nr = key.layer_nr;
     BOOST_LOG_TRIVIAL(debug) << "calculate_avoidance on radius=" << radius << ", layer=" << layer_nr<<", recursion="<<key.recursions;
     constexpr auto max_recursion_depth = 100;
     if (key.recursions <= max_recursion_depth*2) {
-        if (layer_nr == 0) {
-            m_avoidance_cache[key] = get_collision(radius, 0);
-            return m_avoidance_cache[key];
-        }
+        if (layer_nr == 0)
+            return get_collision(radius, 0);
 
         // Avoidance for a given layer depends on all layers beneath it so could have very deep recursion depths if
         // called at high layer heights. We can limit the reqursion depth to N by checking if the layer N
@@ -3688,7 +3751,7 @@ const ExPolygons& TreeSupportData::calculate_avoidance(const RadiusLayerPair& ke
         int            layers_below;
         for (layers_below = 0; layers_below < max_recursion_depth && layer_nr_next > 0; layers_below++) { layer_nr_next = layer_heights[layer_nr_next].next_layer_nr; }
         // Check if we would exceed the recursion limit by trying to process this layer
-        if (layers_below >= max_recursion_depth && m_avoidance_cache.find({radius, layer_nr_next}) == m_avoidance_cache.end()) {
+        if (layers_below >= max_recursion_depth && ! is_cached(m_avoidance_cache, {radius, layer_nr_next})) {
             // Force the calculation of the layer `max_recursion_depth` below our current one, ignoring the result.
             get_avoidance(radius, layer_nr_next, key.recursions + 1);
         }
@@ -3697,15 +3760,9 @@ const ExPolygons& TreeSupportData::calculate_avoidance(const RadiusLayerPair& ke
         ExPolygons        avoidance_areas = std::move(offset_ex(get_avoidance(radius, layer_nr_next, key.recursions+1), scale_(-m_max_move)));
         const ExPolygons &collision       = get_collision(radius, layer_nr);
         avoidance_areas.insert(avoidance_areas.end(), collision.begin(), collision.end());
-        avoidance_areas = std::move(union_ex(avoidance_areas));
-        auto ret = m_avoidance_cache.insert({ key, std::move(avoidance_areas) });
-        //assert(ret.second);
-        return ret.first->second;
+        return union_ex(avoidance_areas);
     } else {
-        ExPolygons avoidance_areas = std::move(offset_ex(m_layer_outlines_below[layer_nr], scale_(m_xy_distance + radius)));
-        auto ret = m_avoidance_cache.insert({ key, std::move(avoidance_areas) });
-        assert(ret.second);
-        return ret.first->second;
+        return offset_ex(m_layer_outlines_below[layer_nr], scale_(m_xy_distance + radius));
     }
 }
 
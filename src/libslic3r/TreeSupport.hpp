@@ -1,7 +1,11 @@
 #ifndef TREESUPPORT_H
 #define TREESUPPORT_H
 
+#include <atomic>
 #include <forward_list>
+#include <functional>
+#include <memory>
+#include <mutex>
 #include <unordered_set>
 #include "ExPolygon.hpp"
 #include "Point.hpp"
@@ -43,7 +47,7 @@ struct TreeNode {
 /*!
  * \brief Lazily generates tree guidance volumes.
  *
- * \warning This class is not currently thread-safe and should not be accessed in OpenMP blocks
+ * The collision and avoidance areas may be requested concurrently, each area is calculated just once.
  */
 class TreeSupportData
 {
@@ -95,6 +99,19 @@ public:
      */
     const ExPolygons& get_avoidance(coordf_t radius, size_t layer_idx, int recursions=0) const;
 
+    /*!
+     * \brief Calculates the collision and avoidance areas in advance.
+     *
+     * The avoidance of a layer depends on the avoidance of the layer below it, thus calculating it on demand
+     * recurses down to the first layer on a single thread. Here the collision areas are calculated in parallel
+     * for all the layers, then the avoidance areas of the radii are calculated in parallel, each radius bottom up.
+     * Requires layer_heights to be planned already.
+     *
+     * \param radii_layers Pairs of a radius and of the highest layer, at which the avoidance of that radius will be requested.
+     * \param canceled Stops the calculation early if it returns true.
+     */
+    void precalculate(const std::vector<std::pair<coordf_t, size_t>> &radii_layers, std::function<bool()> canceled) const;
+
     Polygons get_contours(size_t layer_nr) const;
     Polygons get_contours_with_holes(size_t layer_nr) const;
 
@@ -123,6 +140,24 @@ private:
         }
     };
 
+    /*!
+     * \brief Areas cached for a RadiusLayerPair.
+     *
+     * The first thread requesting the areas calculates them, the other threads requesting the same areas
+     * concurrently wait for the result instead of calculating the same areas again.
+     */
+    struct CachedAreas {
+        std::once_flag      once;
+        ExPolygons          areas;
+        std::atomic<bool>   calculated { false };
+    };
+    using AreasCache = tbb::concurrent_unordered_map<RadiusLayerPair, std::unique_ptr<CachedAreas>, RadiusLayerPairHash, RadiusLayerPairEquality>;
+
+    // Find or insert the cache entry of the key, its areas may not be calculated yet.
+    static CachedAreas& cache_entry(AreasCache &cache, const RadiusLayerPair &key);
+    // Were the areas of the key calculated already?
+    static bool         is_cached(const AreasCache &cache, const RadiusLayerPair &key);
+
     /*!
      * \brief Round \p radius upwards to a multiple of m_radius_sample_resolution
      *
@@ -136,7 +171,7 @@ private:
      *
      * \param key The radius and layer of the node of interest
      */
-    const ExPolygons& calculate_collision(const RadiusLayerPair& key) const;
+    ExPolygons calculate_collision(const RadiusLayerPair& key) const;
 
     /*!
      * \brief Calculate the avoidance areas at the radius and layer indicated
@@ -144,7 +179,7 @@ private:
      *
      * \param key The radius and layer of the node of interest
      */
-    const ExPolygons& calculate_avoidance(const RadiusLayerPair& key) const;
+    ExPolygons calculate_avoidance(const RadiusLayerPair& key) const;
 
 
 public:
@@ -189,8 +224,8 @@ public:
      * coconut: previously stl::unordered_map is used which seems problematic with tbb::parallel_for.
      * So we change to tbb::concurrent_unordered_map
      */
-    mutable tbb::concurrent_unordered_map<RadiusLayerPair, ExPolygons, RadiusLayerPairHash, RadiusLayerPairEquality> m_collision_cache;
-    mutable tbb::concurrent_unordered_map<RadiusLayerPair, ExPolygons, RadiusLayerPairHash, RadiusLayerPairEquality> m_avoidance_cache;
+    mutable AreasCache m_collision_cache;
+    mutable AreasCache m_avoidance_cache;
 
     friend TreeSupport;
 };
@@ -20,7 +20,9 @@
 
 #include <boost/log/trivial.hpp>
 
+#include <tbb/enumerable_thread_specific.h>
 #include <tbb/parallel_for.h>
+#include <tbb/parallel_sort.h>
 
 #ifndef NDEBUG
 //    #define EXPENSIVE_DEBUG_CHECKS
@@ -477,40 +479,38 @@ static FacetSliceType slice_facet_for_cut_mesh(
 }
 
 template<typename TransformVertex>
-void slice_facet_at_zs(
+static inline void slice_facet_at_z(
     // Scaled or unscaled vertices. transform_vertex_fn may scale zs.
     const std::vector<Vec3f>                         &mesh_vertices,
     const TransformVertex                            &transform_vertex_fn,
     const stl_triangle_vertex_indices                &indices,
     const Vec3i                                      &edge_ids,
-    // Scaled or unscaled zs. If vertices have their zs scaled or transform_vertex_fn scales them, then zs have to be scaled as well.
-    const std::vector<float>                         &zs,
-    std::vector<IntersectionLines>                   &lines,
-    std::array<std::mutex, 64>                       &lines_mutex)
+    // Scaled or unscaled z, it has to be inside the Z span of the facet.
+    const float                                       slice_z,
+    IntersectionLines                                &lines)
 {
     stl_vertex vertices[3] { transform_vertex_fn(mesh_vertices[indices(0)]), transform_vertex_fn(mesh_vertices[indices(1)]), transform_vertex_fn(mesh_vertices[indices(2)]) };
-
-    // find facet extents
     const float min_z = fminf(vertices[0].z(), fminf(vertices[1].z(), vertices[2].z()));
-    const float max_z = fmaxf(vertices[0].z(), fmaxf(vertices[1].z(), vertices[2].z()));
-
-    // find layer extents
-    auto min_layer = std::lower_bound(zs.begin(), zs.end(), min_z); // first layer whose slice_z is >= min_z
-    auto max_layer = std::upper_bound(min_layer, zs.end(), max_z); // first layer whose slice_z is > max_z
     int  idx_vertex_lowest = (vertices[1].z() == min_z) ? 1 : ((vertices[2].z() == min_z) ? 2 : 0);
-
-    for (auto it = min_layer; it != max_layer; ++ it) {
-        IntersectionLine il;
-        // Ignore horizontal triangles. Any valid horizontal triangle must have a vertical triangle connected, otherwise the part has zero volume.
-        if (min_z != max_z && slice_facet(*it, vertices, indices, edge_ids, idx_vertex_lowest, false, il) == FacetSliceType::Slicing) {
-            assert(il.edge_type != IntersectionLine::FacetEdgeType::Horizontal);
-            size_t slice_id = it - zs.begin();
-            boost::lock_guard<std::mutex> l(lines_mutex[slice_id % lines_mutex.size()]);
-            lines[slice_id].emplace_back(il);
-        }
+    IntersectionLine il;
+    if (slice_facet(slice_z, vertices, indices, edge_ids, idx_vertex_lowest, false, il) == FacetSliceType::Slicing) {
+        assert(il.edge_type != IntersectionLine::FacetEdgeType::Horizontal);
+        lines.emplace_back(il);
     }
 }
 
+// Z extents of a facet to be sliced.
+struct FacetZSpan {
+    float min_z;
+    float max_z;
+    int   face_idx;
+};
+
+// Slicing by a sweep over the layers instead of searching the layers for each facet.
+// The facets are sorted by their lowest Z once, then the layers are split into chunks of consecutive layers.
+// Each chunk is swept from bottom to top by a single thread, keeping a set of the facets active at the current layer.
+// A layer is only ever written to by the thread sweeping its chunk, thus no locking is needed and the order
+// of the lines is deterministic.
 template<typename TransformVertex, typename ThrowOnCancel>
 static inline std::vector<IntersectionLines> slice_make_lines(
     const std::vector<stl_vertex>                   &vertices,
@@ -521,17 +521,113 @@ static inline std::vector<IntersectionLines> slice_make_lines(
     const ThrowOnCancel                              throw_on_cancel_fn)
 {
     std::vector<IntersectionLines>  lines(zs.size(), IntersectionLines());
-    std::array<std::mutex, 64>      lines_mutex;
+    if (zs.empty() || indices.empty())
+        return lines;
+
+    if (zs.size() == 1) {
+        // A single plane, there is nothing to sweep. Slice the facets in parallel into thread local vectors.
+        const float slice_z = zs.front();
+        tbb::enumerable_thread_specific<IntersectionLines> lines_per_thread;
+        tbb::parallel_for(
+            tbb::blocked_range<int>(0, int(indices.size())),
+            [&vertices, &transform_vertex_fn, &indices, &face_edge_ids, slice_z, &lines_per_thread, throw_on_cancel_fn](const tbb::blocked_range<int> &range) {
+                IntersectionLines &out = lines_per_thread.local();
+                for (int face_idx = range.begin(); face_idx < range.end(); ++ face_idx) {
+                    if ((face_idx & 0x0ffff) == 0)
+                        throw_on_cancel_fn();
+                    const stl_triangle_vertex_indices &face = indices[face_idx];
+                    const float z0 = transform_vertex_fn(vertices[face(0)]).z();
+                    const float z1 = transform_vertex_fn(vertices[face(1)]).z();
+                    const float z2 = transform_vertex_fn(vertices[face(2)]).z();
+                    const float min_z = fminf(z0, fminf(z1, z2));
+                    const float max_z = fmaxf(z0, fmaxf(z1, z2));
+                    // Ignore horizontal triangles. Any valid horizontal triangle must have a vertical triangle connected, otherwise the part has zero volume.
+                    if (min_z != max_z && min_z <= slice_z && max_z >= slice_z)
+                        slice_facet_at_z(vertices, transform_vertex_fn, face, face_edge_ids[face_idx], slice_z, out);
+                }
+            });
+        size_t num_lines = 0;
+        for (const IntersectionLines &l : lines_per_thread)
+            num_lines += l.size();
+        lines.front().reserve(num_lines);
+        for (const IntersectionLines &l : lines_per_thread)
+            append(lines.front(), l);
+        return lines;
+    }
+
+    // Z extents of the facets crossing at least one layer. Horizontal facets are dropped, any valid horizontal triangle
+    // must have a vertical triangle connected, otherwise the part has zero volume.
+    std::vector<FacetZSpan> spans(indices.size());
     tbb::parallel_for(
         tbb::blocked_range<int>(0, int(indices.size())),
-        [&vertices, &transform_vertex_fn, &indices, &face_edge_ids, &zs, &lines, &lines_mutex, throw_on_cancel_fn](const tbb::blocked_range<int> &range) {
+        [&vertices, &transform_vertex_fn, &indices, &zs, &spans, throw_on_cancel_fn](const tbb::blocked_range<int> &range) {
             for (int face_idx = range.begin(); face_idx < range.end(); ++ face_idx) {
                 if ((face_idx & 0x0ffff) == 0)
                     throw_on_cancel_fn();
-                slice_facet_at_zs(vertices, transform_vertex_fn, indices[face_idx], face_edge_ids[face_idx], zs, lines, lines_mutex);
+                const stl_triangle_vertex_indices &face = indices[face_idx];
+                const float z0 = transform_vertex_fn(vertices[face(0)]).z();
+                const float z1 = transform_vertex_fn(vertices[face(1)]).z();
+                const float z2 = transform_vertex_fn(vertices[face(2)]).z();
+                FacetZSpan &span = spans[face_idx];
+                span.min_z = fminf(z0, fminf(z1, z2));
+                span.max_z = fmaxf(z0, fmaxf(z1, z2));
+                // first layer whose slice_z is >= min_z
+                auto it = std::lower_bound(zs.begin(), zs.end(), span.min_z);
+                span.face_idx = span.min_z == span.max_z || it == zs.end() || *it > span.max_z ? -1 : face_idx;
             }
-        }
-    );
+        });
+    spans.erase(std::remove_if(spans.begin(), spans.end(), [](const FacetZSpan &span) { return span.face_idx == -1; }), spans.end());
+    tbb::parallel_sort(spans.begin(), spans.end(), [](const FacetZSpan &l, const FacetZSpan &r) { return l.min_z < r.min_z || (l.min_z == r.min_z && l.face_idx < r.face_idx); });
+    throw_on_cancel_fn();
+
+    // Enough chunks to balance the load over the threads, few enough for the facets crossing the chunk boundaries to be rare.
+    static constexpr const size_t max_chunks = 256;
+    const size_t layers_per_chunk = (zs.size() + max_chunks - 1) / max_chunks;
+    const size_t num_chunks       = (zs.size() + layers_per_chunk - 1) / layers_per_chunk;
+    // Facets [chunk_facets[i], chunk_facets[i + 1]) of spans have their lowest layer in chunk i.
+    std::vector<size_t> chunk_facets(num_chunks + 1, 0);
+    for (size_t chunk_idx = 1; chunk_idx < num_chunks; ++ chunk_idx)
+        chunk_facets[chunk_idx] = std::upper_bound(spans.begin(), spans.end(), zs[chunk_idx * layers_per_chunk - 1],
+            [](float z, const FacetZSpan &span) { return z < span.min_z; }) - spans.begin();
+    chunk_facets.back() = spans.size();
+    // Facets starting below a chunk and reaching into its first layer, indices into spans.
+    std::vector<std::vector<int>> chunk_carried(num_chunks);
+    for (size_t chunk_idx = 0; chunk_idx + 1 < num_chunks; ++ chunk_idx)
+        for (size_t i = chunk_facets[chunk_idx]; i < chunk_facets[chunk_idx + 1]; ++ i)
+            for (size_t next_chunk = chunk_idx + 1; next_chunk < num_chunks && spans[i].max_z >= zs[next_chunk * layers_per_chunk]; ++ next_chunk)
+                chunk_carried[next_chunk].emplace_back(int(i));
+
+    tbb::parallel_for(
+        tbb::blocked_range<size_t>(0, num_chunks),
+        [&vertices, &transform_vertex_fn, &indices, &face_edge_ids, &zs, &lines, &spans, &chunk_facets, &chunk_carried, layers_per_chunk, throw_on_cancel_fn]
+        (const tbb::blocked_range<size_t> &range) {
+            // Facets active at the current layer, indices into spans.
+            std::vector<int> active;
+            for (size_t chunk_idx = range.begin(); chunk_idx < range.end(); ++ chunk_idx) {
+                throw_on_cancel_fn();
+                active = std::move(chunk_carried[chunk_idx]);
+                size_t next_facet = chunk_facets[chunk_idx];
+                size_t end_facet  = chunk_facets[chunk_idx + 1];
+                size_t end_layer  = std::min(zs.size(), (chunk_idx + 1) * layers_per_chunk);
+                for (size_t layer_idx = chunk_idx * layers_per_chunk; layer_idx < end_layer; ++ layer_idx) {
+                    const float slice_z = zs[layer_idx];
+                    for (; next_facet < end_facet && spans[next_facet].min_z <= slice_z; ++ next_facet)
+                        active.emplace_back(int(next_facet));
+                    for (size_t i = 0; i < active.size();) {
+                        const FacetZSpan &span = spans[active[i]];
+                        if (span.max_z < slice_z) {
+                            // The facet is below this layer and all the layers above.
+                            active[i] = active.back();
+                            active.pop_back();
+                        } else {
+                            slice_facet_at_z(vertices, transform_vertex_fn, indices[span.face_idx], face_edge_ids[span.face_idx], slice_z, lines[layer_idx]);
+                            ++ i;
+                        }
+                    }
+                }
+                active.clear();
+            }
+        });
     return lines;
 }
 
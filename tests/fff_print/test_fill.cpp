@@ -190,6 +190,41 @@ TEST_CASE("Fill: Pattern Path Length", "[Fill]") {
     }
 }
 
+TEST_CASE("Fill: Gyroid", "[Fill]") {
+    Slic3r::ExPolygon square { Point::new_scale(0, 0), Point::new_scale(50, 0), Point::new_scale(50, 50), Point::new_scale(0, 50) };
+    FillParams fill_params;
+    fill_params.density     = 0.15f;
+    fill_params.dont_adjust = true;
+
+    auto fill = [&square, &fill_params](double z, const ExPolygon &hole_free) {
+        std::unique_ptr<Slic3r::Fill> filler(Slic3r::Fill::new_from_type(ipGyroid));
+        filler->bounding_box = get_extents(square.contour);
+        filler->spacing      = 0.45;
+        filler->z            = z;
+        Surface surface(stInternal, hole_free);
+        return filler->fill_surface(&surface, fill_params);
+    };
+
+    SECTION("Waves shared by fills at the same Z are the same as newly generated ones") {
+        Polylines paths1 = fill(1.2, square);
+        REQUIRE(! paths1.empty());
+        // The second fill at the same Z reuses the waves of the first one.
+        Polylines paths2 = fill(1.2, square);
+        REQUIRE(paths1 == paths2);
+        // Fill of another layer generates different waves.
+        Polylines paths3 = fill(1.4, square);
+        REQUIRE(! paths3.empty());
+        REQUIRE(paths1 != paths3);
+    }
+    SECTION("Infill stays inside of the surface") {
+        for (double z : { 0.2, 0.4, 3.7, 10.1 }) {
+            Polylines paths = fill(z, square);
+            REQUIRE(! paths.empty());
+            REQUIRE(diff_pl(paths, offset(square, float(SCALED_EPSILON * 10))).empty());
+        }
+    }
+}
+
 /*
 {
     my $collection = Slic3r::Polyline::Collection->new(
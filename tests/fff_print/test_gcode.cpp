@@ -3,6 +3,10 @@
 #include <memory>
 
 #include "libslic3r/GCode.hpp"
+#include "libslic3r/GCodeReader.hpp"
+
+#include <boost/filesystem/operations.hpp>
+#include <boost/nowide/fstream.hpp>
 
 using namespace Slic3r;
 
@@ -20,3 +24,55 @@ SCENARIO("Origin manipulation", "[GCode]") {
     	}
     }
 }
+
+SCENARIO("GCodeReader parses a file", "[GCode]") {
+    GIVEN("G-code with mixed line endings and an unterminated last line") {
+        const std::string path = (boost::filesystem::temp_directory_path() / boost::filesystem::unique_path("%%%%-%%%%.gcode")).string();
+        {
+            boost::nowide::ofstream out(path, std::ios::binary);
+            out << "G1 X1 Y2\r\n; comment\nG1 Z0.2 E1.5 F1200\n\nG1 X3";
+        }
+        GCodeReader reader;
+        std::vector<std::string> lines;
+        std::vector<size_t>      lines_ends;
+        bool ok = reader.parse_file(path, [&lines](GCodeReader &, const GCodeReader::GCodeLine &line) { lines.emplace_back(line.raw()); }, lines_ends);
+        boost::filesystem::remove(path);
+        THEN("all lines are parsed") {
+            REQUIRE(ok);
+            REQUIRE(lines == std::vector<std::string>{ "G1 X1 Y2", "; comment", "G1 Z0.2 E1.5 F1200", "", "G1 X3" });
+            REQUIRE(lines_ends == std::vector<size_t>{ 10, 20, 39, 40 });
+        }
+        THEN("the reader position follows the moves") {
+            REQUIRE(reader.x() == Approx(3.f));
+            REQUIRE(reader.y() == Approx(2.f));
+            REQUIRE(reader.z() == Approx(0.2f));
+            REQUIRE(reader.e() == Approx(1.5f));
+        }
+    }
+}
+
+SCENARIO("GCodeReader parses a file larger than a parsing block in order", "[GCode]") {
+    GIVEN("G-code of 200000 moves") {
+        const std::string path = (boost::filesystem::temp_directory_path() / boost::filesystem::unique_path("%%%%-%%%%.gcode")).string();
+        const int num_lines = 200000;
+        {
+            boost::nowide::ofstream out(path, std::ios::binary);
+            for (int i = 1; i <= num_lines; ++ i)
+                out << "G1 X" << i << " E0.1\n";
+        }
+        GCodeReader reader;
+        int  num_parsed = 0;
+        bool in_order   = true;
+        std::vector<size_t> lines_ends;
+        reader.parse_file(path, [&num_parsed, &in_order](GCodeReader &reader, const GCodeReader::GCodeLine &line) {
+            in_order &= int(line.x()) == ++ num_parsed && int(reader.x()) == num_parsed - 1;
+        }, lines_ends);
+        boost::filesystem::remove(path);
+        THEN("the lines are passed to the callback in the file order") {
+            REQUIRE(num_parsed == num_lines);
+            REQUIRE(in_order);
+            REQUIRE(lines_ends.size() == num_lines);
+            REQUIRE(reader.x() == Approx(float(num_lines)));
+        }
+    }
+}
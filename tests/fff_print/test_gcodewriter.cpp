@@ -2,6 +2,7 @@
 
 #include <memory>
 
+#include "libslic3r/GCodeReader.hpp"
 #include "libslic3r/GCodeWriter.hpp"
 
 using namespace Slic3r;
@@ -94,3 +95,19 @@ SCENARIO("set_speed emits values with fixed-point output.", "[GCodeWriter]") {
         }
     }
 }
+
+SCENARIO("G-code filters edit values with the writer's formatting.", "[GCodeWriter]") {
+
+    GIVEN("A G-code line parsed by GCodeReader") {
+        GCodeReader reader;
+        GCodeReader::GCodeLine line;
+        reader.parse_line("G1 X10.5 Y20 E0.12345", [&line](GCodeReader&, const GCodeReader::GCodeLine &l) { line = l; });
+        WHEN("Z is set to 0.3 and E to 0.1") {
+            line.set(reader, Z, 0.3f);
+            line.set(reader, E, 0.1f, GCodeFormatter::E_EXPORT_DIGITS);
+            THEN("Trailing zeros are trimmed the same way GCodeWriter does") {
+                REQUIRE_THAT(line.raw(), Catch::Equals("G1 Z0.3 X10.5 Y20 E0.1"));
+            }
+        }
+    }
+}
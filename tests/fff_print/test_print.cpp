@@ -3,6 +3,10 @@
 #include "libslic3r/libslic3r.h"
 #include "libslic3r/Print.hpp"
 #include "libslic3r/Layer.hpp"
+#include "libslic3r/Utils.hpp"
+#include "libslic3r/Format/SliceCache.hpp"
+
+#include <boost/filesystem/operations.hpp>
 
 #include "test_data.hpp"
 
@@ -126,3 +130,70 @@ SCENARIO("Print: Brim generation", "[Print]") {
         }
     }
 }
+
+SCENARIO("Print: Slice cache round trip", "[Print]") {
+    GIVEN("sliced 20mm cube") {
+        Slic3r::Print print;
+        Slic3r::Model model;
+        Slic3r::Test::init_print({TestMesh::cube_20x20x20}, print, model, { { "fill_density", 0.2 } });
+        print.process();
+        const PrintObject &object = *print.objects().front();
+        std::vector<double> areas;
+        std::vector<size_t> perimeters;
+        for (const Layer *layer : object.layers()) {
+            areas.emplace_back(area(layer->lslices));
+            perimeters.emplace_back(layer->regions().front()->perimeters.items_count());
+        }
+        const std::string directory = (boost::filesystem::temp_directory_path() / boost::filesystem::unique_path()).string();
+        WHEN("the layers are exported and loaded back") {
+            REQUIRE(print.export_cached_data(directory) == 0);
+            REQUIRE(print.load_cached_data(directory) == 0);
+            THEN("the loaded layers match the sliced ones") {
+                REQUIRE(object.layers().size() == areas.size());
+                for (size_t i = 0; i < areas.size(); ++ i) {
+                    REQUIRE(area(object.layers()[i]->lslices) == Approx(areas[i]));
+                    REQUIRE(object.layers()[i]->regions().front()->perimeters.items_count() == perimeters[i]);
+                }
+            }
+        }
+        WHEN("the object changes after export") {
+            REQUIRE(print.export_cached_data(directory) == 0);
+            model.objects.front()->volumes.front()->scale(Vec3d(1., 1., 0.5));
+            DynamicPrintConfig config = print.full_print_config();
+            print.apply(model, config);
+            THEN("the cache is rejected") {
+                REQUIRE(print.load_cached_data(directory) == CLI_IMPORT_CACHE_DATA_CAN_NOT_USE);
+            }
+        }
+        boost::filesystem::remove_all(directory);
+    }
+}
+
+SCENARIO("Print: Slice cache stores ids independent of the record size", "[Print]") {
+    GIVEN("sliced 20mm cube with a high layer id and a high volume id") {
+        Slic3r::Print print;
+        Slic3r::Model model;
+        Slic3r::Test::init_print({TestMesh::cube_20x20x20}, print, model);
+        print.process();
+        PrintObject &object = *print.get_object(0);
+        const size_t layer_id  = size_t(1) << 40;
+        const size_t volume_id = size_t(1) << 41;
+        object.get_layer(int(object.layer_count() - 1))->set_id(layer_id);
+        SliceCache::FirstLayerGroups groups(1);
+        groups.front().groupId = 3;
+        groups.front().volume_ids.emplace_back(volume_id);
+        const std::string path = (boost::filesystem::temp_directory_path() / boost::filesystem::unique_path()).string();
+        WHEN("the layers are saved and loaded back") {
+            SliceCache::save(path, object, "cube", 0, groups);
+            SliceCache::Reader reader(path);
+            THEN("the ids are restored") {
+                REQUIRE(reader.layers().back().id == layer_id);
+                SliceCache::FirstLayerGroups loaded = reader.load_first_layer_groups();
+                REQUIRE(loaded.size() == 1);
+                REQUIRE(loaded.front().groupId == 3);
+                REQUIRE(loaded.front().volume_ids == std::vector<ObjectID>{ ObjectID(volume_id) });
+            }
+        }
+        boost::filesystem::remove(path);
+    }
+}
@@ -87,3 +87,37 @@ SCENARIO("PrintObject: object layer heights", "[PrintObject]") {
 #endif
     }
 }
+
+SCENARIO("PrintObject: Perimeters outside of a changed layer range are kept", "[PrintObject]") {
+    GIVEN("20mm cube with arc fitting and a layer range modifier from 5mm to 10mm") {
+        Slic3r::Print print;
+        Slic3r::Model model;
+        Slic3r::Test::init_print({TestMesh::cube_20x20x20}, print, model, { { "enable_arc_fitting", true } });
+        model.objects.front()->layer_config_ranges[{ 5., 10. }].set("wall_loops", 2);
+        print.apply(model, print.full_print_config());
+        print.process();
+        auto perimeters_outside_range = [&print]() {
+            std::vector<Polylines> out;
+            for (const Layer *layer : print.objects().front()->layers())
+                if (layer->print_z < 4.5 || layer->print_z > 10.5)
+                    for (const LayerRegion *layerm : layer->regions())
+                        out.emplace_back(layerm->perimeters.as_polylines());
+            return out;
+        };
+        const std::vector<Polylines> perimeters = perimeters_outside_range();
+        WHEN("the number of walls of the layer range is changed") {
+            model.objects.front()->layer_config_ranges[{ 5., 10. }].set("wall_loops", 3);
+            print.apply(model, print.full_print_config());
+            print.process();
+            THEN("the perimeters of the other layers are not modified") {
+                const std::vector<Polylines> perimeters_after = perimeters_outside_range();
+                REQUIRE(perimeters_after.size() == perimeters.size());
+                for (size_t i = 0; i < perimeters.size(); ++ i) {
+                    REQUIRE(perimeters_after[i].size() == perimeters[i].size());
+                    for (size_t j = 0; j < perimeters[i].size(); ++ j)
+                        REQUIRE(perimeters_after[i][j].points == perimeters[i][j].points);
+                }
+            }
+        }
+    }
+}
@@ -177,6 +177,29 @@ SCENARIO( "TriangleMesh: slice behavior.") {
     }
 }
 
+SCENARIO( "TriangleMesh: slicing many layers at once.") {
+    GIVEN( "A sphere with many facets crossing several layers") {
+        auto sphere = make_sphere(10., 2. * PI / 60.);
+        // More layers than twice the number of chunks of the slicer, so that a chunk slices several layers
+        // and facets expire from its active set.
+        std::vector<double> z;
+        for (int i = 0; i < 996; ++ i)
+            z.emplace_back(-9.95 + 0.02 * i);
+        WHEN("The layers are sliced at once and one by one") {
+            std::vector<ExPolygons> result = sphere.slice(z);
+            THEN( "The slices are the same.") {
+                REQUIRE(result.size() == z.size());
+                for (size_t i = 0U; i < z.size(); i++) {
+                    std::vector<ExPolygons> single = sphere.slice({ z[i] });
+                    REQUIRE(result[i].size() == 1);
+                    REQUIRE(single.front().size() == 1);
+                    REQUIRE(result[i].front().area() == Approx(single.front().front().area()));
+                }
+            }
+        }
+    }
+}
+
 SCENARIO( "make_xxx functions produce meshes.") {
     GIVEN("make_cube() function") {
         WHEN("make_cube() is called with arguments 20,20,20") {
@@ -58,3 +58,34 @@ TEST_CASE("Building a tree over a box, ray caster and closest query", "[AABBIndi
     REQUIRE(closest_point.y() == Approx(0.5));
     REQUIRE(closest_point.z() == Approx(1.));
 }
+
+TEST_CASE("Ray packet casting matches single ray casting", "[AABBIndirect]")
+{
+    TriangleMesh tmesh = make_sphere(1., 2. * PI / 40.);
+    auto tree = AABBTreeIndirect::build_aabb_tree_over_indexed_triangle_set(tmesh.its.vertices, tmesh.its.indices);
+    REQUIRE(! tree.empty());
+
+    // Rays from a common origin outside of the sphere, some of them missing it, the last lane of the packet unused.
+    constexpr size_t packet_size = 8;
+    std::vector<Vec3d> origins(packet_size - 1, Vec3d(0.2, -0.1, -3.));
+    std::vector<Vec3d> dirs;
+    for (size_t i = 0; i < origins.size(); ++ i)
+        dirs.emplace_back(Vec3d(0.15 * double(i) - 0.45, 0.1, 1.).normalized());
+
+    std::array<igl::Hit, packet_size> hits;
+    uint32_t mask = AABBTreeIndirect::intersect_ray_packet_first_hit(
+        tmesh.its.vertices, tmesh.its.indices, tree, origins.data(), dirs.data(), origins.size(), hits);
+    REQUIRE(mask != 0);
+    REQUIRE(mask != (uint32_t(1) << origins.size()) - 1);
+
+    for (size_t i = 0; i < origins.size(); ++ i) {
+        igl::Hit hit;
+        bool intersected = AABBTreeIndirect::intersect_ray_first_hit(
+            tmesh.its.vertices, tmesh.its.indices, tree, origins[i], dirs[i], hit);
+        REQUIRE(intersected == bool((mask >> i) & 1));
+        if (intersected) {
+            REQUIRE(hits[i].id == hit.id);
+            REQUIRE(hits[i].t == Approx(hit.t));
+        }
+    }
+}
@@ -2,12 +2,15 @@
 
 #include "libslic3r/PrintConfig.hpp"
 #include "libslic3r/LocalesUtils.hpp"
+#include "libslic3r/PresetIndex.hpp"
 
 #include <cereal/types/polymorphic.hpp>
 #include <cereal/types/string.hpp> 
 #include <cereal/types/vector.hpp> 
 #include <cereal/archives/binary.hpp>
 
+#include <boost/filesystem.hpp>
+
 using namespace Slic3r;
 
 SCENARIO("Generic config validation performs as expected.", "[Config]") {
@@ -237,3 +240,61 @@ SCENARIO("DynamicPrintConfig serialization", "[Config]") {
         }
     }
 }
+
+SCENARIO("Preset index stores presets relative to the defaults", "[Config]") {
+    GIVEN("A config with a few options modified from the defaults") {
+        const DynamicPrintConfig defaults = DynamicPrintConfig::full_print_config();
+        DynamicPrintConfig config = defaults;
+        config.set_deserialize_strict({ { "layer_height", "0.12" }, { "wall_loops", "3" }, { "sparse_infill_density", "15%" } });
+        PresetIndex::Entry entry;
+        entry.type = Preset::TYPE_PRINT;
+        entry.name = "0.12mm Fine";
+        entry.renamed_from = { "0.12mm Fine Old" };
+        REQUIRE(PresetIndex::diff_options(config, defaults, entry.options));
+        THEN("Only the modified options are stored") {
+            REQUIRE(entry.options.size() == 3);
+        }
+        WHEN("The index is saved and read back") {
+            const std::string path = (boost::filesystem::temp_directory_path() / boost::filesystem::unique_path("preset_index_%%%%%%.idx")).string();
+            PresetIndex::save(path, 0x1234, { entry });
+            PresetIndex::Entry loaded;
+            uint64_t           hash = 0;
+            {
+                PresetIndex::Reader index(path);
+                hash = index.hash();
+                REQUIRE(index.size() == 1);
+                REQUIRE(index.type(0) == Preset::TYPE_PRINT);
+                loaded = index.entry(0);
+            }
+            boost::filesystem::remove(path);
+            DynamicPrintConfig restored = defaults;
+            PresetIndex::apply_options(loaded.options, restored);
+            THEN("The preset is restored exactly") {
+                REQUIRE(hash == 0x1234);
+                REQUIRE(loaded.name == entry.name);
+                REQUIRE(loaded.renamed_from == entry.renamed_from);
+                REQUIRE(restored == config);
+            }
+        }
+    }
+}
+
+SCENARIO("Static config diffs walking the option table match the generic diff", "[Config]") {
+    GIVEN("A default PrintRegionConfig and a full print config with a few region options modified") {
+        const PrintRegionConfig region_config;
+        DynamicPrintConfig      full_config = DynamicPrintConfig::full_print_config();
+        full_config.set_deserialize_strict({ { "wall_loops", "4" }, { "sparse_infill_density", "35%" }, { "layer_height", "0.1" } });
+        PrintRegionConfig       region_config_new;
+        region_config_new.apply(full_config, true);
+        THEN("Diff against a DynamicConfig lists the modified region options only") {
+            const t_config_option_keys diff = region_config.diff(full_config);
+            REQUIRE(diff == static_cast<const ConfigBase&>(region_config).diff(static_cast<const ConfigBase&>(full_config)));
+            REQUIRE(diff == t_config_option_keys{ "sparse_infill_density", "wall_loops" });
+        }
+        THEN("Diff against a static config of the same type matches the generic diff") {
+            const t_config_option_keys diff = region_config.diff(region_config_new);
+            REQUIRE(diff == static_cast<const ConfigBase&>(region_config).diff(static_cast<const ConfigBase&>(region_config_new)));
+            REQUIRE(diff == t_config_option_keys{ "sparse_infill_density", "wall_loops" });
+        }
+    }
+}
@@ -34,6 +34,26 @@ SCENARIO("Placeholder parser scripting", "[PlaceholderParser]") {
     SECTION("array reference") { REQUIRE(parser.process("{temperature[foo]}") == "357"); }
     SECTION("whitespaces and newlines are maintained") { REQUIRE(parser.process("test [ temperature_ [foo] ] \n hu") == "test 357 \n hu"); }
 
+    // Test the templates split into text, legacy variables and macros.
+    SECTION("compiled: text and legacy variables") { REQUIRE(parser.process("M104 S[temperature] T[foo]\n;[temperature_1]\n") == "M104 S357 T0\n;359\n"); }
+    SECTION("compiled: leading white space is skipped") { REQUIRE(parser.process(" \n G1 [bar]") == "G1 2"); }
+    SECTION("compiled: if block between text") { REQUIRE(parser.process("A{if foo == 0}B[bar]{if bar == 2}C{endif}{else}D{endif}E{bar}") == "AB2CE2"); }
+    SECTION("compiled: repeated processing") { REQUIRE(parser.process("G1 [temperature]", 2) == "G1 363"); REQUIRE(parser.process("G1 [temperature]", 3) == "G1 378"); }
+    SECTION("compiled: brace inside a regular expression") {
+        DynamicConfig outputs;
+        outputs.set_key_value("position", new ConfigOptionFloats({ 0., 0., 0. }));
+        REQUIRE(parser.process("{position[0] = position[0] + 1}{(printer_notes =~ /[}]?.*MK2.*/)}", 0, nullptr, &outputs, nullptr) == "true");
+        REQUIRE(outputs.opt<ConfigOptionFloats>("position")->values.front() == 1.);
+    }
+    SECTION("compiled: error line counted from the start of the template") {
+        try {
+            parser.process("G1 [bar]\nG2\n{foo +}\n");
+            REQUIRE(false);
+        } catch (const PlaceholderParserError &err) {
+            REQUIRE(std::string(err.what()).find("line 3") != std::string::npos);
+        }
+    }
+
     // Test the math expressions.
     SECTION("math: 2*3") { REQUIRE(parser.process("{2*3}") == "6"); }
     SECTION("math: 2*3/6") { REQUIRE(parser.process("{2*3/6}") == "1"); }